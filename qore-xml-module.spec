@@ -57,6 +57,7 @@ BuildRequires: qore-stdlib >= 2.0
 BuildRequires: qore >= 2.0
 BuildRequires: libxml2-devel
 BuildRequires: openssl-devel
+BuildRequires: zlib-devel
 BuildRequires: fdupes
 BuildRequires: doxygen
 %if 0%{?suse_version} || 0%{?sles_version}
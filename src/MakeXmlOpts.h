@@ -25,6 +25,7 @@
 #define MAKE_XML_OPTS_H
 
 #include <cassert>
+#include <memory>
 #include <string>
 #include <stdexcept>
 #include "qore/QoreEncoding.h"
@@ -33,6 +34,51 @@
 #include "qore/QoreValue.h"
 #include "qore-xml-module.h"
 
+/**
+ * A date format compiled for fast serialization of absolute dates.
+ *
+ * Only formats consisting of the YYYY, MM, DD, HH, mm and SS codes and
+ * punctuation are compiled; other formats, relative dates and years outside
+ * of 0 - 9999 are formatted with DateTimeNode::format().
+ */
+class MakeXmlDateFormat final {
+public:
+    /**
+     * Compiles the format; the format is not compiled if it contains
+     * unsupported codes.
+     */
+    void compile(const std::string &format);
+
+    /**
+     * Appends the formatted date to the string.
+     * @returns True if the date was formatted, False if
+     *          DateTimeNode::format() must be used instead.
+     */
+    bool format(QoreString &str, const DateTimeNode &date) const;
+
+private:
+    enum Op : unsigned char {
+        OP_END = 0,
+        OP_YEAR,    //!< YYYY
+        OP_MONTH,   //!< MM
+        OP_DAY,     //!< DD
+        OP_HOUR,    //!< HH
+        OP_MINUTE,  //!< mm
+        OP_SECOND,  //!< SS
+        OP_LITERAL, //!< the character in the next byte
+    };
+
+    /// maximum number of opcode bytes in a compiled format
+    static const size_t MAX_OPS = 32;
+
+    /// the opcode list terminated with OP_END
+    unsigned char m_ops[MAX_OPS + 1] = {OP_END};
+    /// True if the format is compiled
+    bool m_compiled = false;
+    /// True if the format is "YYYYMMDDHHmmSS"
+    bool m_basic = false;
+};
+
 /**
  * Wrapper for xml generating options.
  */
@@ -60,6 +106,11 @@ public:
      */
     explicit MakeXmlOpts();
 
+    /**
+     * Returns a shared instance with default options.
+     */
+    static const MakeXmlOpts& getDefault();
+
     MakeXmlOpts(const MakeXmlOpts&) = default;
     MakeXmlOpts& operator=(const MakeXmlOpts&) = default;
 
@@ -119,6 +170,23 @@ public:
     bool m_useNumericRefs;
     /// format of dates when serializing into xml
     std::string m_dateFormat;
+    /// maximum number of threads used to serialize large lists; 0 or 1 = serialize in the calling thread
+    int64 m_parallel;
+    /// compression method for binary and stream output: "gzip", "zlib", "deflate" or "zstd"; empty = none
+    std::string m_compress;
+    /// compression level; -1 = the default level for the compression method
+    int64 m_compressLevel;
+    /// XSD schema for validating the generated XML in UTF-8 encoding; nullptr = no validation
+    std::shared_ptr<const QoreString> m_xsd;
+    /// m_dateFormat compiled; call compileDateFormat() after changing m_dateFormat
+    MakeXmlDateFormat m_compiledDateFormat;
+
+    /**
+     * Compiles m_dateFormat into m_compiledDateFormat.
+     */
+    void compileDateFormat() {
+        m_compiledDateFormat.compile(m_dateFormat);
+    }
 };
 
 // ------------- impl --------------
@@ -147,5 +215,12 @@ void MakeXmlOpts::parseValue<std::string>(
         const std::string &key, qore_type_t valueType,
         bool mandatory);
 
+// int64 specialization
+template <>
+void MakeXmlOpts::parseValue<int64>(
+        int64 &output, const QoreHashNode *hash,
+        const std::string &key, qore_type_t valueType,
+        bool mandatory);
+
 
 #endif // !MAKE_XML_OPTS_H
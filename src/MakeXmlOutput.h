@@ -0,0 +1,359 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    MakeXmlOutput.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MAKE_XML_OUTPUT_H
+#define MAKE_XML_OUTPUT_H
+
+#include <qore/Qore.h>
+#include "qore/OutputStream.h"
+#include "XmlEscape.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// size of the internal buffer used when serializing XML to a sink
+#define MAKE_XML_FLUSH_SIZE (64 * 1024)
+
+// maximum number of distinct hash keys cached for a single serialization call
+#define MAKE_XML_TAG_CACHE_SIZE 4096
+
+/**
+ * A hash key prepared for use as an XML tag name.
+ */
+struct MakeXmlTagName {
+    //! the hash key
+    std::string key;
+    //! the validated tag name in the output encoding with any "^<n>" suffix removed
+    std::string tag;
+};
+
+/**
+ * Tag names for hash keys for a single serialization call.
+ *
+ * Keys that need no conversion and start with an ASCII character are
+ * validated and used in place without a lookup. Other keys are converted to
+ * the output encoding, validated and stripped of their "^<n>" suffix the
+ * first time they are seen; repeated keys are then found in a cache by
+ * content without any allocation.
+ */
+class MakeXmlTagCache {
+public:
+    DLLLOCAL MakeXmlTagCache(const QoreEncoding* enc) : enc(enc) {
+    }
+
+    /**
+     * Gets the tag name for the given hash key.
+     *
+     * The tag name is not null-terminated; it points into \a key, into the
+     * cache or, if the cache is full, into \a tmp.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int get(ExceptionSink* xsink, const char* key, MakeXmlTagName& tmp, const char*& tag, size_t& tag_len) {
+        size_t len = strlen(key);
+        if (enc == QCS_DEFAULT && (unsigned char)key[0] < 0x80) {
+            if (!xml_is_name_start_char((unsigned char)key[0])) {
+                xsink->raiseException("MAKE-XML-ERROR", "tag: \"%s\" is not a valid XML tag element name", key);
+                return -1;
+            }
+            tag = key;
+            tag_len = stripSuffix(key, len);
+            return 0;
+        }
+
+        const MakeXmlTagName* t = lookup(xsink, key, len, tmp);
+        if (!t)
+            return -1;
+        tag = t->tag.data();
+        tag_len = t->tag.size();
+        return 0;
+    }
+
+    /**
+     * Returns the tag name for the given hash key as a string.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int get(ExceptionSink* xsink, const char* key, std::string& tag) {
+        MakeXmlTagName tmp;
+        const char* t;
+        size_t len;
+        if (get(xsink, key, tmp, t, len))
+            return -1;
+        tag.assign(t, len);
+        return 0;
+    }
+
+private:
+    //! the output encoding
+    const QoreEncoding* enc;
+    //! cached tag names
+    std::vector<std::unique_ptr<MakeXmlTagName>> entries;
+    //! open-addressing hash table of entries; the size is always a power of two
+    std::vector<MakeXmlTagName*> slots;
+
+    /**
+     * Returns the cached tag name for the given hash key, adding it to the cache if necessary.
+     *
+     * If the cache is full, the tag name is prepared in \a tmp.
+     * @returns the tag name or nullptr if an exception was raised
+     */
+    DLLLOCAL const MakeXmlTagName* lookup(ExceptionSink* xsink, const char* key, size_t len, MakeXmlTagName& tmp) {
+        size_t hash = getHash(key, len);
+
+        if (!slots.empty()) {
+            size_t mask = slots.size() - 1;
+            for (size_t i = hash & mask; slots[i]; i = (i + 1) & mask) {
+                const MakeXmlTagName* t = slots[i];
+                if (t->key.size() == len && !memcmp(t->key.data(), key, len))
+                    return t;
+            }
+        }
+
+        if (entries.size() >= MAKE_XML_TAG_CACHE_SIZE)
+            return prepare(xsink, key, len, tmp) ? nullptr : &tmp;
+
+        std::unique_ptr<MakeXmlTagName> t(new MakeXmlTagName);
+        if (prepare(xsink, key, len, *t))
+            return nullptr;
+
+        // keep the load factor under 50%
+        if ((entries.size() + 1) * 2 > slots.size())
+            rehash(slots.empty() ? 64 : slots.size() * 2);
+        insert(t.get(), hash);
+        entries.push_back(std::move(t));
+        return entries.back().get();
+    }
+
+    //! returns the length of the tag name without any "^<n>" suffix
+    DLLLOCAL static size_t stripSuffix(const char* tag, size_t len) {
+        size_t l = len - 1;
+        while (isdigit((unsigned char)tag[l]))
+            --l;
+        return l != len - 1 && tag[l] == '^' ? l : len;
+    }
+
+    // FNV-1a
+    DLLLOCAL static size_t getHash(const char* key, size_t len) {
+        size_t hash = 2166136261u;
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= (unsigned char)key[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    DLLLOCAL void insert(MakeXmlTagName* t, size_t hash) {
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i])
+            i = (i + 1) & mask;
+        slots[i] = t;
+    }
+
+    DLLLOCAL void rehash(size_t size) {
+        slots.assign(size, nullptr);
+        for (auto& i : entries)
+            insert(i.get(), getHash(i->key.data(), i->key.size()));
+    }
+
+    /**
+     * Checks the first character of a hash key; the character is classified by its code point, so the result does
+     * not depend on the locale.
+     * @returns 0 = OK, 1 = invalid name, -1 = error (exception raised)
+     */
+    DLLLOCAL static int checkNameStart(ExceptionSink* xsink, const char* key, size_t len) {
+        if (!len)
+            return 1;
+        if ((unsigned char)key[0] < 0x80)
+            return xml_is_name_start_char((unsigned char)key[0]) ? 0 : 1;
+
+        std::unique_ptr<QoreString> utf8;
+        if (QCS_DEFAULT != QCS_UTF8) {
+            QoreString ks(key, len, QCS_DEFAULT);
+            utf8.reset(ks.convertEncoding(QCS_UTF8, xsink));
+            if (*xsink)
+                return -1;
+            key = utf8->c_str();
+            len = utf8->size();
+        }
+        unsigned cp;
+        if (!xml_escape_decode_utf8(reinterpret_cast<const unsigned char*>(key), len, cp))
+            return 1;
+        return xml_is_name_start_char(cp) ? 0 : 1;
+    }
+
+    /**
+     * Converts, validates and strips the suffix from a hash key.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int prepare(ExceptionSink* xsink, const char* key, size_t len, MakeXmlTagName& t) {
+        t.key.assign(key, len);
+        if (enc != QCS_DEFAULT) {
+            QoreString ks(key, len, QCS_DEFAULT);
+            std::unique_ptr<QoreString> ns(ks.convertEncoding(enc, xsink));
+            if (*xsink)
+                return -1;
+            t.tag.assign(ns->c_str(), ns->size());
+        } else {
+            t.tag = t.key;
+        }
+
+        // make sure it's a valid XML tag element name
+        int rc = checkNameStart(xsink, key, len);
+        if (rc < 0)
+            return -1;
+        if (rc) {
+            xsink->raiseException("MAKE-XML-ERROR", "tag: \"%s\" is not a valid XML tag element name",
+                t.tag.c_str());
+            return -1;
+        }
+
+        // process key name - remove ^# from end of key name if present
+        t.tag.resize(stripSuffix(t.tag.data(), t.tag.size()));
+        return 0;
+    }
+};
+
+/**
+ * Destination for serialized XML data flushed from a MakeXmlOutput buffer.
+ */
+class AbstractXmlOutputSink {
+public:
+    DLLLOCAL virtual ~AbstractXmlOutputSink() {
+    }
+
+    /**
+     * Writes a block of serialized XML data.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL virtual int write(const char* data, size_t len, ExceptionSink* xsink) = 0;
+
+    /**
+     * Called once after the last block has been written.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL virtual int finish(ExceptionSink* xsink) {
+        return 0;
+    }
+};
+
+/**
+ * Writes serialized XML data to an OutputStream; the stream is not closed.
+ */
+class OutputStreamXmlSink : public AbstractXmlOutputSink {
+public:
+    DLLLOCAL OutputStreamXmlSink(OutputStream* os) : os(os) {
+    }
+
+    DLLLOCAL virtual int write(const char* data, size_t len, ExceptionSink* xsink) {
+        os->write(data, len, xsink);
+        return *xsink ? -1 : 0;
+    }
+
+private:
+    OutputStream* os;
+};
+
+/**
+ * Appends serialized XML data to a string; the data must be in the string's encoding.
+ */
+class StringXmlSink : public AbstractXmlOutputSink {
+public:
+    DLLLOCAL StringXmlSink(QoreString& str) : str(str) {
+    }
+
+    DLLLOCAL virtual int write(const char* data, size_t len, ExceptionSink* xsink) {
+        str.concat(data, len);
+        return 0;
+    }
+
+private:
+    QoreString& str;
+};
+
+/**
+ * The buffer that XML is serialized into.
+ *
+ * Without a sink, the buffer accumulates the entire document. With a sink,
+ * the buffer is written to the sink and cleared whenever it grows over the
+ * flush size at an element boundary, so memory usage does not depend on the
+ * size of the document.
+ */
+class MakeXmlOutput {
+public:
+    //! the output buffer
+    QoreString& str;
+    //! tag names for hash keys
+    MakeXmlTagCache tags;
+
+    DLLLOCAL MakeXmlOutput(QoreString& str, AbstractXmlOutputSink* sink = nullptr,
+            size_t flush_size = MAKE_XML_FLUSH_SIZE) : str(str), tags(str.getEncoding()), sink(sink),
+            flush_size(flush_size) {
+    }
+
+    /**
+     * Flushes the buffer if it has reached the flush size.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int checkFlush(ExceptionSink* xsink) {
+        if (!sink || str.size() < flush_size)
+            return 0;
+        return flush(xsink);
+    }
+
+    /**
+     * Writes any buffered data to the sink.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int flush(ExceptionSink* xsink) {
+        if (!sink || !str.size())
+            return 0;
+        int rc = sink->write(str.c_str(), str.size(), xsink);
+        str.clear();
+        return rc;
+    }
+
+    /**
+     * Flushes the buffer and finishes the sink.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int finish(ExceptionSink* xsink) {
+        if (!sink)
+            return 0;
+        if (flush(xsink))
+            return -1;
+        return sink->finish(xsink);
+    }
+
+    DLLLOCAL bool hasSink() const {
+        return sink;
+    }
+
+private:
+    AbstractXmlOutputSink* sink;
+    size_t flush_size;
+};
+
+#endif // !MAKE_XML_OUTPUT_H
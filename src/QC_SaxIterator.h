@@ -26,6 +26,7 @@
 #define _QORE_QC_SAXITERATOR_H
 
 #include "QC_XmlReader.h"
+#include "QoreXmlDataBuilder.h"
 #include "qore/InputStream.h"
 
 #include <string>
@@ -47,6 +48,8 @@ protected:
     int element_depth = -1;
     int xml_parse_options;
     bool val = false;
+    //! hashdecl options for the values returned
+    XmlDataOpts dopts;
 
 public:
     DLLLOCAL QoreSaxIterator(InputStream *is, const char* ename, const char* enc, const QoreHashNode* opts, ExceptionSink* xsink) : QoreXmlReaderData(is, enc, setOptions(opts), opts, xsink), element_name(ename), val(true) {
@@ -61,7 +64,24 @@ public:
     DLLLOCAL QoreSaxIterator(ExceptionSink* xsink, const char* fn, const char* ename, const char* enc = nullptr, const QoreHashNode* opts = nullptr) : QoreXmlReaderData(fn, enc, setOptions(opts), opts, xsink), element_name(ename) {
     }
 
-    DLLLOCAL QoreSaxIterator(const QoreSaxIterator& old, ExceptionSink* xsink) : QoreXmlReaderData(old, xsink), element_name(old.element_name), xml_parse_options(old.xml_parse_options) {
+    DLLLOCAL QoreSaxIterator(const QoreSaxIterator& old, ExceptionSink* xsink) : QoreXmlReaderData(old, xsink), element_name(old.element_name), xml_parse_options(old.xml_parse_options), dopts(old.dopts) {
+    }
+
+    /**
+     * Processes the \c hashdecl, \c hashdecls and \c reject_unknown options.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int setDataOptions(const QoreHashNode* opts, const char* err, ExceptionSink* xsink) {
+        if (!opts)
+            return 0;
+        ConstHashIterator i(opts);
+        while (i.next()) {
+            const char* key = i.getKey();
+            if ((!strcmp(key, "hashdecl") || !strcmp(key, "hashdecls") || !strcmp(key, "reject_unknown"))
+                && dopts.set(xsink, err, key, i.get()) < 0)
+                return -1;
+        }
+        return 0;
     }
 
     DLLLOCAL QoreValue getReferencedValue(ExceptionSink* xsink) {
@@ -77,7 +97,7 @@ public:
         if (!reader)
             return QoreValue();
 
-        ReferenceHolder<QoreHashNode> h(reader.parseXmlData(QCS_UTF8, xml_parse_options, xsink), xsink);
+        ReferenceHolder<QoreHashNode> h(reader.parseXmlData(QCS_UTF8, xml_parse_options, xsink, dopts.get()), xsink);
         if (*xsink)
             return QoreValue();
         // issue #2487 element may be present with a prefix
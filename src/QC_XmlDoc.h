@@ -38,8 +38,12 @@ class QoreXmlDocData : public AbstractPrivateData, public QoreXmlDoc {
 public:
    DLLLOCAL QoreXmlDocData(const char *buf, int size) : QoreXmlDoc(buf, size) {
    }
+   DLLLOCAL QoreXmlDocData(const char *buf, int size, const char *encoding, int options) : QoreXmlDoc(buf, size, encoding, options) {
+   }
    DLLLOCAL QoreXmlDocData(const QoreString &xml) : QoreXmlDoc(xml) {
    }
+   DLLLOCAL QoreXmlDocData(xmlDocPtr doc) : QoreXmlDoc(doc) {
+   }
    DLLLOCAL QoreXmlDocData(const QoreXmlDocData &orig) : QoreXmlDoc(orig) {
    }
    DLLLOCAL QoreXmlNodeData *getRootElement();
@@ -0,0 +1,116 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QC_XmlSerializerTemplate.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_QC_XMLSERIALIZERTEMPLATE_H
+
+#define _QORE_QC_XMLSERIALIZERTEMPLATE_H
+
+#include "qore-xml-module.h"
+#include "MakeXmlOpts.h"
+#include "MakeXmlOutput.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+DLLEXPORT extern qore_classid_t CID_XMLSERIALIZERTEMPLATE;
+DLLLOCAL QoreClass* initXmlSerializerTemplateClass(QoreNamespace& ns);
+
+DLLLOCAL extern QoreClass* QC_XMLSERIALIZERTEMPLATE;
+
+/**
+ * Serializes hashes with a fixed layout to XML documents.
+ *
+ * The layout of a sample hash is compiled into a tree of nodes holding the
+ * prepared markup for each element. Values are checked against the layout
+ * when serialized; any element whose value does not match the compiled
+ * layout is serialized with the generic make_xml() code, so the output is
+ * always identical to make_xml() with the same options.
+ */
+class QoreXmlSerializerTemplate : public AbstractPrivateData {
+public:
+    DLLLOCAL QoreXmlSerializerTemplate(const MakeXmlOpts& opts) : opts(opts) {
+    }
+
+    /**
+     * Compiles the layout of the sample hash.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int compile(ExceptionSink* xsink, const QoreHashNode& sample);
+
+    /**
+     * Serializes the hash to a complete XML document.
+     * @returns the XML document or nullptr if an exception was raised
+     */
+    DLLLOCAL QoreStringNode* serialize(ExceptionSink* xsink, const QoreHashNode& h) const;
+
+private:
+    enum NodeType {
+        XST_LEAF,    //!< an element with a simple value
+        XST_HASH,    //!< an element with child elements and optionally attributes
+        XST_LIST,    //!< a list of elements with the same tag name
+        XST_GENERIC, //!< an element serialized with the generic code
+    };
+
+    struct Node {
+        NodeType type;
+        //! the indentation of the element
+        int indent;
+        //! the tag name
+        std::string tag;
+        //! "<tag"
+        std::string open;
+        //! "</tag>"
+        std::string close;
+
+        //! XST_HASH: the hash keys in order, including any "^attributes^" key
+        std::vector<std::string> keys;
+        //! XST_HASH: child elements in the order of their keys
+        std::vector<std::unique_ptr<Node>> children;
+        //! XST_HASH: the attribute names in order
+        std::vector<std::string> attr_names;
+        //! XST_HASH: ' name="' for each attribute
+        std::vector<std::string> attr_prefixes;
+        //! XST_HASH: the position of the "^attributes^" key in keys or -1 if there is none
+        int attr_pos = -1;
+
+        //! XST_LIST: the element node for list entries
+        std::unique_ptr<Node> elem;
+    };
+
+    MakeXmlOpts opts;
+    //! the root element; nullptr if the document cannot be compiled
+    std::unique_ptr<Node> root;
+    //! the hash key of the root element
+    std::string root_key;
+
+    DLLLOCAL std::unique_ptr<Node> compileElement(ExceptionSink* xsink, MakeXmlTagCache& tags, const char* key,
+            const QoreValue v, int indent);
+
+    DLLLOCAL int serializeElement(ExceptionSink* xsink, MakeXmlOutput& out, const Node& node, const QoreValue v) const;
+
+    //! returns true if the hash matches the compiled layout
+    DLLLOCAL static bool matchHash(const Node& node, const QoreHashNode& h, QoreValue& attrib);
+};
+
+#endif
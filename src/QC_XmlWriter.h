@@ -0,0 +1,132 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QC_XmlWriter.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_QC_XMLWRITER_H
+
+#define _QORE_QC_XMLWRITER_H
+
+#include "qore-xml-module.h"
+#include "qore/OutputStream.h"
+#include "ql_xml.h"
+
+#include <libxml/xmlwriter.h>
+
+#include <memory>
+
+DLLEXPORT extern qore_classid_t CID_XMLWRITER;
+DLLLOCAL QoreClass* initXmlWriterClass(QoreNamespace& ns);
+
+DLLLOCAL extern QoreClass* QC_XMLWRITER;
+
+/**
+ * Writes XML incrementally with a libxml2 xmlTextWriter.
+ *
+ * Output goes to a string, a file or an OutputStream; with files and
+ * streams, the output is written in blocks as the libxml2 output buffer
+ * fills, so memory usage does not depend on the size of the document.
+ *
+ * All string arguments are converted to UTF-8 for libxml2; the output
+ * encoding is set with startDocument().
+ *
+ * If an XSD schema is given, the output is validated with a
+ * QoreXmlSchemaPushValidator before it is written.
+ */
+class QoreXmlWriter : public AbstractPrivateData {
+public:
+    //! creates a writer that writes to a string
+    DLLLOCAL QoreXmlWriter(const QoreEncoding* enc) : enc(enc), str(new QoreStringNode(QCS_UTF8)) {
+    }
+
+    //! creates a writer that writes to the output stream; takes over the reference
+    DLLLOCAL QoreXmlWriter(const QoreEncoding* enc, OutputStream* os) : enc(enc), os(os) {
+    }
+
+    /**
+     * Creates the libxml2 writer.
+     * @param path the file to write to or nullptr to write to the string or output stream
+     * @param xsd an XSD schema for validating the output or nullptr
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int init(ExceptionSink* xsink, const char* path, bool indent, const QoreString* indent_str,
+            const QoreString* xsd);
+
+    //! closes the writer, writing any buffered output, and releases the output stream
+    DLLLOCAL virtual void deref(ExceptionSink* xsink);
+
+    DLLLOCAL int startDocument(ExceptionSink* xsink, const QoreString* version, const QoreValue standalone);
+    DLLLOCAL int endDocument(ExceptionSink* xsink);
+    DLLLOCAL int startElement(ExceptionSink* xsink, const QoreString* prefix, const QoreString& name,
+            const QoreString* uri);
+    DLLLOCAL int endElement(ExceptionSink* xsink, bool full);
+    DLLLOCAL int writeElement(ExceptionSink* xsink, const QoreString& name, const QoreString* content);
+    DLLLOCAL int writeAttribute(ExceptionSink* xsink, const QoreString* prefix, const QoreString& name,
+            const QoreString* uri, const QoreString& value);
+    DLLLOCAL int writeText(ExceptionSink* xsink, const QoreString& text);
+    DLLLOCAL int writeCData(ExceptionSink* xsink, const QoreString& data);
+    DLLLOCAL int writeComment(ExceptionSink* xsink, const QoreString& comment);
+    DLLLOCAL int writePI(ExceptionSink* xsink, const QoreString& target, const QoreString* content);
+    DLLLOCAL int writeRaw(ExceptionSink* xsink, const QoreString& xml);
+    DLLLOCAL int flush(ExceptionSink* xsink);
+
+    //! returns the output written to the string so far or nullptr if an exception was raised
+    DLLLOCAL QoreStringNode* getString(ExceptionSink* xsink);
+
+private:
+    QoreThreadLock m;
+    //! the output encoding of the document
+    const QoreEncoding* enc;
+    xmlTextWriterPtr writer = nullptr;
+    //! string output
+    SimpleRefHolder<QoreStringNode> str;
+    //! stream output
+    OutputStream* os = nullptr;
+    //! file output when the output is validated; otherwise the file buffer is owned by the writer
+    xmlOutputBufferPtr file = nullptr;
+#ifdef HAVE_XMLTEXTREADERSETSCHEMA
+    //! validates the output with the "xsd" option
+    std::unique_ptr<QoreXmlSchemaPushValidator> validator;
+#endif
+    //! the exception sink of the current call for errors raised by the output stream
+    ExceptionSink* cur_xsink = nullptr;
+
+    DLLLOCAL virtual ~QoreXmlWriter() {
+        assert(!writer);
+        assert(!os);
+        assert(!file);
+    }
+
+    //! processes the return value of an xmlTextWriter function
+    DLLLOCAL int check(ExceptionSink* xsink, int rc, const char* meth) {
+        cur_xsink = nullptr;
+        if (rc >= 0)
+            return 0;
+        if (!*xsink)
+            xsink->raiseException("XMLWRITER-ERROR", "XmlWriter::%s(): libxml2 returned an error writing the XML "
+                "output; check that elements are properly nested and that the output is writable", meth);
+        return -1;
+    }
+
+    DLLLOCAL static int writeCallback(void* ctx, const char* buf, int len);
+};
+
+#endif
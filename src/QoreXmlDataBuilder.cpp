@@ -0,0 +1,1087 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QoreXmlDataBuilder.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "QoreXmlDataBuilder.h"
+#include "XmlSaxParser.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <string>
+
+struct XmlTypeInfo {
+    //! the XSD type name
+    const char* name;
+    XmlValueType type;
+    //! the range of integer types
+    int64 min, max;
+};
+
+// the types supported by the "types" option; names are XSD built-in type names or Qore type names
+static const XmlTypeInfo xml_types[] = {
+    {"string", XVT_STRING, 0, 0},
+    {"integer", XVT_INT, INT64_MIN, INT64_MAX},
+    {"long", XVT_INT, INT64_MIN, INT64_MAX},
+    {"int", XVT_INT, INT32_MIN, INT32_MAX},
+    {"short", XVT_INT, INT16_MIN, INT16_MAX},
+    {"byte", XVT_INT, INT8_MIN, INT8_MAX},
+    {"nonNegativeInteger", XVT_INT, 0, INT64_MAX},
+    {"positiveInteger", XVT_INT, 1, INT64_MAX},
+    {"nonPositiveInteger", XVT_INT, INT64_MIN, 0},
+    {"negativeInteger", XVT_INT, INT64_MIN, -1},
+    {"unsignedLong", XVT_INT, 0, INT64_MAX},
+    {"unsignedInt", XVT_INT, 0, UINT32_MAX},
+    {"unsignedShort", XVT_INT, 0, UINT16_MAX},
+    {"unsignedByte", XVT_INT, 0, UINT8_MAX},
+    {"float", XVT_FLOAT, 0, 0},
+    {"double", XVT_FLOAT, 0, 0},
+    {"decimal", XVT_NUMBER, 0, 0},
+    {"number", XVT_NUMBER, 0, 0},
+    {"boolean", XVT_BOOL, 0, 0},
+    {"bool", XVT_BOOL, 0, 0},
+    {"date", XVT_DATE, 0, 0},
+    {"dateTime", XVT_DATETIME, 0, 0},
+    {"time", XVT_TIME, 0, 0},
+    {"base64Binary", XVT_BASE64, 0, 0},
+    {"binary", XVT_BASE64, 0, 0},
+    {"hexBinary", XVT_HEX, 0, 0},
+    // the conversion for hashdecl members of type date; this entry cannot be selected by name
+    {"date or dateTime", XVT_DATE_ANY, 0, 0},
+};
+
+// the number of types that can be selected by name
+#define XML_NAMED_TYPES (sizeof(xml_types) / sizeof(xml_types[0]) - 1)
+
+static bool is_xml_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// parses an integer; returns 0 = OK, -1 = invalid or out of range for int64
+static int parse_xml_int(const char* p, const char* e, int64& v) {
+    bool neg = false;
+    if (p < e && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        ++p;
+    }
+    if (p == e)
+        return -1;
+    // the value is accumulated as a negative number to cover INT64_MIN
+    int64 rv = 0;
+    for (; p < e; ++p) {
+        if (*p < '0' || *p > '9')
+            return -1;
+        int d = *p - '0';
+        if (rv < (INT64_MIN + d) / 10)
+            return -1;
+        rv = rv * 10 - d;
+    }
+    if (!neg) {
+        if (rv == INT64_MIN)
+            return -1;
+        rv = -rv;
+    }
+    v = rv;
+    return 0;
+}
+
+// returns true if the string is a decimal number with an optional exponent
+static bool is_xml_decimal(const char* p, const char* e, bool exp) {
+    if (p < e && (*p == '-' || *p == '+'))
+        ++p;
+    bool digits = false;
+    for (; p < e && *p >= '0' && *p <= '9'; ++p)
+        digits = true;
+    if (p < e && *p == '.') {
+        for (++p; p < e && *p >= '0' && *p <= '9'; ++p)
+            digits = true;
+    }
+    if (!digits)
+        return false;
+    if (exp && p < e && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p < e && (*p == '-' || *p == '+'))
+            ++p;
+        if (p == e)
+            return false;
+        for (; p < e && *p >= '0' && *p <= '9'; ++p)
+            ;
+    }
+    return p == e;
+}
+
+// parses exactly n digits; returns the position after the digits or nullptr if there are fewer than n digits
+static const char* parse_xml_digits(const char* p, const char* e, int n, int& v) {
+    if (e - p < n)
+        return nullptr;
+    v = 0;
+    for (const char* de = p + n; p < de; ++p) {
+        if (*p < '0' || *p > '9')
+            return nullptr;
+        v = v * 10 + (*p - '0');
+    }
+    return p;
+}
+
+static bool is_xml_leap_year(int year) {
+    // XSD years are proleptic Gregorian years where year -1 is followed by year 1
+    if (year < 0)
+        ++year;
+    return !(year % 4) && ((year % 100) || !(year % 400));
+}
+
+// parses the date part of an xsd:date or xsd:dateTime value: [-]YYYY-MM-DD
+static const char* parse_xml_date(const char* p, const char* e, int& year, int& month, int& day) {
+    bool neg = p < e && *p == '-';
+    if (neg)
+        ++p;
+    // years have at least four digits and no leading zero if they have more
+    const char* ys = p;
+    int64 y = 0;
+    for (; p < e && *p >= '0' && *p <= '9'; ++p) {
+        y = y * 10 + (*p - '0');
+        if (y > INT_MAX)
+            return nullptr;
+    }
+    if (p - ys < 4 || (p - ys > 4 && *ys == '0') || !y)
+        return nullptr;
+    year = neg ? -(int)y : (int)y;
+
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (p == e || *p++ != '-' || !(p = parse_xml_digits(p, e, 2, month)) || month < 1 || month > 12
+        || p == e || *p++ != '-' || !(p = parse_xml_digits(p, e, 2, day)) || day < 1
+        || day > days[month - 1] + (month == 2 && is_xml_leap_year(year)))
+        return nullptr;
+    return p;
+}
+
+// parses an xsd:time value without a time zone: hh:mm:ss[.s+]
+static const char* parse_xml_time(const char* p, const char* e, int& hour, int& minute, int& second, int& us) {
+    if (!(p = parse_xml_digits(p, e, 2, hour)) || hour > 23
+        || p == e || *p++ != ':' || !(p = parse_xml_digits(p, e, 2, minute)) || minute > 59
+        || p == e || *p++ != ':' || !(p = parse_xml_digits(p, e, 2, second)) || second > 59)
+        return nullptr;
+    us = 0;
+    if (p < e && *p == '.') {
+        // fractional seconds are truncated to microseconds
+        const char* fs = ++p;
+        for (int scale = 100000; p < e && *p >= '0' && *p <= '9'; ++p, scale /= 10)
+            us += (*p - '0') * scale;
+        if (p == fs)
+            return nullptr;
+    }
+    return p;
+}
+
+// parses an optional time zone at the end of a value: Z or (+|-)hh:mm; returns the zone or currentTZ() if none
+static bool parse_xml_zone(const char* p, const char* e, const AbstractQoreZoneInfo*& zone) {
+    if (p == e) {
+        zone = currentTZ();
+        return true;
+    }
+    if (*p == 'Z') {
+        zone = findCreateOffsetZone(0);
+        return p + 1 == e;
+    }
+    if (*p != '+' && *p != '-')
+        return false;
+    bool neg = *p++ == '-';
+    int hour, minute;
+    if (!(p = parse_xml_digits(p, e, 2, hour)) || p == e || *p++ != ':' || !(p = parse_xml_digits(p, e, 2, minute))
+        || p != e || minute > 59 || hour > 14 || (hour == 14 && minute))
+        return false;
+    int secs = (hour * 60 + minute) * 60;
+    zone = findCreateOffsetZone(neg ? -secs : secs);
+    return true;
+}
+
+// parses an xsd:date, xsd:dateTime or xsd:time value; returns nullptr if the value is not valid for the type
+static DateTimeNode* parse_xml_date_value(XmlValueType type, const char* p, const char* e) {
+    int year = 1970, month = 1, day = 1, hour = 0, minute = 0, second = 0, us = 0;
+    if (type != XVT_TIME && !(p = parse_xml_date(p, e, year, month, day)))
+        return nullptr;
+    if (type == XVT_TIME || ((type == XVT_DATETIME || type == XVT_DATE_ANY) && p < e && *p == 'T')) {
+        if (type != XVT_TIME)
+            ++p;
+        if (!(p = parse_xml_time(p, e, hour, minute, second, us)))
+            return nullptr;
+    } else if (type == XVT_DATETIME) {
+        return nullptr;
+    }
+    const AbstractQoreZoneInfo* zone;
+    if (!parse_xml_zone(p, e, zone))
+        return nullptr;
+    return DateTimeNode::makeAbsolute(zone, year, month, day, hour, minute, second, us);
+}
+
+// a null-terminated copy of a value for conversion; short values are copied to the stack
+class XmlValueBuffer {
+public:
+    DLLLOCAL XmlValueBuffer(const char* p, size_t size) {
+        if (size < sizeof(buf)) {
+            memcpy(buf, p, size);
+            buf[size] = '\0';
+            str = buf;
+        } else {
+            heap.assign(p, size);
+            str = heap.c_str();
+        }
+    }
+
+    DLLLOCAL const char* c_str() const {
+        return str;
+    }
+
+private:
+    char buf[64];
+    std::string heap;
+    const char* str;
+};
+
+static bool keys_are_equal(const char* k1, const char* k2, bool &get_value) {
+    while (true) {
+        if (!(*k1)) {
+            if (!(*k2))
+                return true;
+            if ((*k2) == '^') {
+                get_value = true;
+                return true;
+            }
+            return false;
+        }
+        if ((*k1) != (*k2))
+            break;
+        k1++;
+        k2++;
+    }
+    return false;
+}
+
+// returns true if the string only contains ASCII characters
+static bool is_ascii(const char* str, size_t len) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(str);
+    const unsigned char* e = p + len;
+    // check eight bytes at a time
+    for (; p + 8 <= e; p += 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        if (v & 0x8080808080808080ULL)
+            return false;
+    }
+    for (; p < e; ++p) {
+        if (*p & 0x80)
+            return false;
+    }
+    return true;
+}
+
+int QoreXmlDataBuilder::findType(const char* name) {
+    // XSD types may be given with a namespace prefix
+    const char* p = strchr(name, ':');
+    if (p)
+        name = p + 1;
+    for (unsigned i = 0; i < XML_NAMED_TYPES; ++i) {
+        if (!strcmp(xml_types[i].name, name))
+            return i;
+    }
+    return -1;
+}
+
+// returns the index in the type table of the type that strings are converted to for the member type, or -1 if the
+// member accepts strings or no conversion is supported
+/* numeric types are checked from the most general to the most specific, as number members also accept float and int
+   values and float members also accept int values
+*/
+static int get_member_conversion(const QoreTypeInfo* ti) {
+    if (qore_type_is_assignable_from(ti, stringTypeInfo))
+        return -1;
+    if (qore_type_is_assignable_from(ti, numberTypeInfo))
+        return QoreXmlDataBuilder::findType("decimal");
+    if (qore_type_is_assignable_from(ti, floatTypeInfo))
+        return QoreXmlDataBuilder::findType("double");
+    if (qore_type_is_assignable_from(ti, bigIntTypeInfo))
+        return QoreXmlDataBuilder::findType("long");
+    if (qore_type_is_assignable_from(ti, boolTypeInfo))
+        return QoreXmlDataBuilder::findType("boolean");
+    if (qore_type_is_assignable_from(ti, dateTypeInfo))
+        return XML_NAMED_TYPES;
+    if (qore_type_is_assignable_from(ti, binaryTypeInfo))
+        return QoreXmlDataBuilder::findType("base64Binary");
+    return -1;
+}
+
+QoreXmlDataBuilder::~QoreXmlDataBuilder() {
+    // release the default values of typed hashes that were not completed
+    for (TypedHash& th : typed_hashes) {
+        for (auto& i : th.set)
+            i.second.discard(xsink);
+    }
+}
+
+QoreValue QoreXmlDataBuilder::convertValue(int type, const char* element, const char* str, size_t len) {
+    const XmlTypeInfo& t = xml_types[type];
+    // leading and trailing whitespace is ignored in values that are not strings
+    const char* p = str;
+    const char* e = str + len;
+    while (p < e && is_xml_space(*p))
+        ++p;
+    while (e > p && is_xml_space(e[-1]))
+        --e;
+    size_t size = e - p;
+
+    switch (t.type) {
+        case XVT_INT: {
+            int64 v;
+            if (!parse_xml_int(p, e, v) && v >= t.min && v <= t.max)
+                return v;
+            break;
+        }
+
+        case XVT_FLOAT:
+            if ((size == 3 && !memcmp(p, "INF", 3)) || (size == 4 && !memcmp(p, "+INF", 4)))
+                return INFINITY;
+            if (size == 4 && !memcmp(p, "-INF", 4))
+                return -INFINITY;
+            if (size == 3 && !memcmp(p, "NaN", 3))
+                return NAN;
+            if (is_xml_decimal(p, e, true))
+                return q_strtod(XmlValueBuffer(p, size).c_str());
+            break;
+
+        case XVT_NUMBER:
+            if (is_xml_decimal(p, e, false))
+                return new QoreNumberNode(XmlValueBuffer(p, size).c_str());
+            break;
+
+        case XVT_BOOL:
+            if ((size == 4 && !memcmp(p, "true", 4)) || (size == 1 && *p == '1'))
+                return true;
+            if ((size == 5 && !memcmp(p, "false", 5)) || (size == 1 && *p == '0'))
+                return false;
+            break;
+
+        case XVT_DATE:
+        case XVT_DATETIME:
+        case XVT_DATE_ANY:
+        case XVT_TIME: {
+            DateTimeNode* d = parse_xml_date_value(t.type, p, e);
+            if (d)
+                return d;
+            break;
+        }
+
+        case XVT_BASE64:
+        case XVT_HEX: {
+            if (!size)
+                return new BinaryNode;
+            // decoding errors are reported as conversion errors
+            ExceptionSink xs;
+            BinaryNode* b = t.type == XVT_BASE64 ? parseBase64(p, (int)size, &xs) : parseHex(p, (int)size, &xs);
+            if (!xs)
+                return b;
+            xs.clear();
+            break;
+        }
+
+        case XVT_STRING:
+            assert(false);
+            break;
+    }
+
+    xsink->raiseException("PARSE-XML-TYPE-ERROR", "cannot convert value '%s' of element '%s' to type '%s'",
+        std::string(str, len).c_str(), element, t.name);
+    return QoreValue();
+}
+
+QoreStringNode* QoreXmlDataBuilder::getValue(const char* str, size_t len) {
+    if (data_ccsid == QCS_UTF8)
+        return new QoreStringNode(str, len, QCS_UTF8);
+
+    // ASCII text needs no conversion for ASCII-compatible encodings
+    if (data_ccsid->isAsciiCompat() && is_ascii(str, len))
+        return new QoreStringNode(str, len, data_ccsid);
+
+    if (!transcoder) {
+        std::unique_ptr<XmlTranscoder> t(new XmlTranscoder);
+        if (t->init(xsink, data_ccsid))
+            return nullptr;
+        transcoder = std::move(t);
+    }
+
+    QoreStringNodeHolder rv(new QoreStringNode(data_ccsid));
+    if (transcoder->convert(xsink, str, len, **rv) || transcoder->finish(xsink, **rv))
+        return nullptr;
+    return rv.release();
+}
+
+int QoreXmlDataBuilder::element(const char* name, int depth) {
+    // a new element ends the value of the last typed element and completes typed hashes at the same depth
+    type_depth = -1;
+    typed_element = false;
+    if (!typed_hashes.empty() && endTypedHashes(depth))
+        return -1;
+
+    if (skip_depth >= 0) {
+        if (depth > skip_depth)
+            return 0;
+        skip_depth = -1;
+    }
+    if (types)
+        typeElement(name, depth);
+    if (filter && !filterElement(name, depth))
+        return 0;
+
+    if (inTypedHash(depth))
+        return addMember(name, depth);
+    addElement(name, depth);
+    return dopts ? startTypedHash(name, depth) : 0;
+}
+
+QoreValue QoreXmlDataBuilder::takeValue() {
+    if (!typed_hashes.empty() && endTypedHashes(0))
+        return QoreValue();
+    return xstack.takeValue();
+}
+
+int QoreXmlDataBuilder::startTypedHash(const char* name, int depth) {
+    XmlHashDecl* decl = dopts->findHashDecl(name, depth);
+    if (!decl)
+        return 0;
+
+    // the typed hash is created with the default values of all members
+    QoreHashNode* h = new QoreHashNode(decl->hd, xsink);
+    xstack.setNode(h);
+    if (*xsink)
+        return -1;
+    typed_hashes.push_back(TypedHash{h, decl, depth, {}});
+    typed_element = true;
+    // typed hashes have no text value
+    if (type_depth == depth)
+        type_depth = -1;
+    return 0;
+}
+
+const QoreExternalMemberBase* QoreXmlDataBuilder::findMember(const char* name, int& conv) {
+    XmlHashDecl* decl = typed_hashes.back().decl;
+    // members are matched by local name
+    const char* p = strchr(name, ':');
+    const QoreExternalMemberBase* m = decl->hd->findLocalMember(p ? p + 1 : name);
+    if (!m)
+        return nullptr;
+
+    for (auto& i : decl->conversions) {
+        if (i.first == m) {
+            conv = i.second;
+            return m;
+        }
+    }
+    conv = get_member_conversion(m->getTypeInfo());
+    decl->conversions.push_back(std::make_pair(m, conv));
+    return m;
+}
+
+QoreValue& QoreXmlDataBuilder::setMember(const QoreExternalMemberBase* m) {
+    TypedHash& th = typed_hashes.back();
+    QoreValue& v = th.h->getKeyValueReference(m->getName());
+    for (auto& i : th.set) {
+        if (i.first == m) {
+            // the member is repeated; make a list with the current value as the first entry
+            QoreListNode* vl = v.getType() == NT_LIST ? v.get<QoreListNode>() : nullptr;
+            if (!vl) {
+                vl = new QoreListNode(autoTypeInfo);
+                vl->push(v, xsink);
+                v = vl;
+            }
+            return vl->getEntryReference(vl->size());
+        }
+    }
+
+    // the default value is kept until the typed hash is completed
+    th.set.push_back(std::make_pair(m, v));
+    v = QoreValue();
+    return v;
+}
+
+int QoreXmlDataBuilder::unknownMember(const char* type, const char* name) {
+    if (!dopts->reject_unknown)
+        return 0;
+    const char* hdname = typed_hashes.back().decl->hd->getName();
+    if (name)
+        xsink->raiseException("PARSE-XML-HASHDECL-ERROR", "%s '%s' is not a member of hashdecl '%s'", type, name,
+            hdname);
+    else
+        xsink->raiseException("PARSE-XML-HASHDECL-ERROR", "%s is not supported in elements with hashdecl '%s'", type,
+            hdname);
+    return -1;
+}
+
+int QoreXmlDataBuilder::addMember(const char* name, int depth) {
+    xstack.checkDepth(depth);
+
+    int conv;
+    const QoreExternalMemberBase* m = findMember(name, conv);
+    if (!m) {
+        if (unknownMember("element", name))
+            return -1;
+        skip_depth = depth;
+        return 0;
+    }
+
+    xstack.push(setMember(m), depth);
+    // the values of members that do not accept strings are converted as they are read, unless a type is given
+    if (conv >= 0 && type_depth < 0) {
+        type_depth = depth;
+        type_index = conv;
+        type_element = name;
+    }
+    return startTypedHash(name, depth);
+}
+
+int QoreXmlDataBuilder::endTypedHashes(int depth) {
+    int rc = 0;
+    while (!typed_hashes.empty() && typed_hashes.back().depth >= depth) {
+        TypedHash& th = typed_hashes.back();
+        for (auto& i : th.set) {
+            QoreValue& v = th.h->getKeyValueReference(i.first->getName());
+            if (v.isNothing()) {
+                // the member has no value in the document; restore the default value
+                v = i.second;
+                continue;
+            }
+            i.second.discard(xsink);
+            if (rc)
+                continue;
+            // check the value against the member type and apply its conversions
+            ValueHolder nv(qore_type_assign_value(i.first->getTypeInfo(), v, xsink), xsink);
+            if (*xsink) {
+                rc = -1;
+                continue;
+            }
+            v.discard(xsink);
+            v = nv.release();
+        }
+        typed_hashes.pop_back();
+        if (rc)
+            return rc;
+    }
+    return rc;
+}
+
+bool QoreXmlDataBuilder::filterElement(const char* name, int depth) {
+    if (select_depth >= 0) {
+        if (depth > select_depth)
+            return true;
+        select_depth = -1;
+    }
+
+    // remove ancestors that have been closed
+    while (!ancestors.empty() && ancestors.back().depth >= depth)
+        ancestors.pop_back();
+
+    switch (filter->match(name, depth)) {
+        case XPM_SKIP:
+            skip_depth = depth;
+            return false;
+
+        case XPM_ANCESTOR:
+            ancestors.push_back(Ancestor{name, depth, false});
+            return false;
+
+        case XPM_SELECT:
+            break;
+    }
+
+    // ancestors are only added when an element below them is selected
+    for (Ancestor& a : ancestors) {
+        if (!a.added) {
+            addElement(a.name, a.depth);
+            a.added = true;
+        }
+    }
+    select_depth = depth;
+    return true;
+}
+
+void QoreXmlDataBuilder::typeElement(const char* name, int depth) {
+    if (type_skip_depth >= 0) {
+        if (depth > type_skip_depth)
+            return;
+        type_skip_depth = -1;
+    }
+
+    switch (types->match(name, depth)) {
+        case XPM_SKIP:
+            type_skip_depth = depth;
+            break;
+
+        case XPM_ANCESTOR:
+            break;
+
+        case XPM_SELECT:
+            type_index = types->getTag();
+            if (xml_types[type_index].type != XVT_STRING) {
+                type_depth = depth;
+                type_element = name;
+            }
+            break;
+    }
+}
+
+void QoreXmlDataBuilder::addElement(const char* name, int depth) {
+    xstack.checkDepth(depth);
+
+    QoreValue n = xstack.getValue();
+    // if there is no node pointer, then make a hash
+    if (n.isNothing()) {
+        QoreHashNode* h = new QoreHashNode(autoTypeInfo);
+        xstack.setNode(h);
+        xstack.push(h->getKeyValueReference(name), depth);
+        return;
+    }
+
+    // node ptr already exists
+    QoreHashNode* h = n.getType() == NT_HASH ? n.get<QoreHashNode>() : nullptr;
+    if (!h) {
+        h = new QoreHashNode(autoTypeInfo);
+        xstack.setNode(h);
+        h->setKeyValue("^value^", n, xsink);
+        xstack.incValueCount();
+        xstack.push(h->getKeyValueReference(name), depth);
+        return;
+    }
+
+    // see if key already exists
+    QoreValue v;
+    bool exists;
+    v = h->getKeyValueExistence(name, exists);
+
+    if (!exists) {
+        xstack.push(h->getKeyValueReference(name), depth);
+        return;
+    }
+
+    if (!(pflags & XPF_PRESERVE_ORDER)) {
+        QoreListNode* vl = v.getType() == NT_LIST ? v.get<QoreListNode>() : nullptr;
+        // if it's not a list, then make into a list with current value as first entry
+        if (!vl) {
+            QoreValue& vp = h->getKeyValueReference(name);
+            vl = new QoreListNode(autoTypeInfo);
+            vl->push(v, xsink);
+            vp = vl;
+        }
+        xstack.push(vl->getEntryReference(vl->size()), depth);
+        return;
+    }
+
+    // see if last key was the same, if so make a list if it's not
+    const char* lk = h->getLastKey();
+    bool get_value = false;
+    if (keys_are_equal(name, lk, get_value)) {
+        // get actual key value if there was a suffix
+        if (get_value)
+            v = h->getKeyValue(lk);
+
+        QoreListNode* vl = v.getType() == NT_LIST ? v.get<QoreListNode>() : nullptr;
+        // if it's not a list, then make into a list with current value as first entry
+        if (!vl) {
+            QoreValue& vp = h->getKeyValueReference(lk);
+            vl = new QoreListNode(autoTypeInfo);
+            vl->push(v, xsink);
+            vp = vl;
+        }
+        xstack.push(vl->getEntryReference(vl->size()), depth);
+        return;
+    }
+
+    // suffixed keys are only created here and are numbered in order per name
+    QoreString ns;
+    ns.sprintf("%s^%d", name, xstack.nextSuffix(name));
+    assert(!h->existsKey(ns.c_str()));
+    xstack.push(h->getKeyValueReference(ns.c_str()), depth);
+}
+
+int QoreXmlDataBuilder::attribute(const char* name, const char* value, size_t len) {
+    if (skip_depth >= 0 || (filter && select_depth < 0))
+        return 0;
+    if (typed_element) {
+        // namespace declarations are not assigned to members
+        if (!strncmp(name, "xmlns", 5) && (!name[5] || name[5] == ':'))
+            return 0;
+        int conv;
+        const QoreExternalMemberBase* m = findMember(name, conv);
+        if (!m)
+            return unknownMember("attribute", name);
+        setMember(m) = conv >= 0 ? convertValue(conv, name, value, len) : QoreValue(getValue(value, len));
+        return *xsink ? -1 : 0;
+    }
+    if (!attrs)
+        attrs = new QoreHashNode(autoTypeInfo);
+    QoreStringNode* val = getValue(value, len);
+    if (!val)
+        return -1;
+    attrs->setKeyValue(name, val, xsink);
+    return 0;
+}
+
+int QoreXmlDataBuilder::endAttributes() {
+    if (skip_depth >= 0 || (filter && select_depth < 0) || typed_element)
+        return 0;
+    if (*xsink)
+        return -1;
+    if (!attrs)
+        attrs = new QoreHashNode(autoTypeInfo);
+
+    // make new new a hash and assign "^attributes^" key
+    QoreHashNode* nv = new QoreHashNode(autoTypeInfo);
+    nv->setKeyValue("^attributes^", attrs.release(), xsink);
+    xstack.setNode(nv);
+    return 0;
+}
+
+int QoreXmlDataBuilder::text(const char* str, size_t len, int depth) {
+    if (!typed_hashes.empty() && endTypedHashes(depth))
+        return -1;
+    if (skipped(depth) || (filter && !selected(depth)))
+        return 0;
+    if (inTypedHash(depth))
+        return unknownMember("text", nullptr);
+    xstack.checkDepth(depth);
+    if (!str)
+        return 0;
+
+    ValueHolder val(typed(depth) ? getTypedValue(str, len) : QoreValue(getValue(str, len)), xsink);
+    if (*xsink)
+        return -1;
+
+    QoreValue n = xstack.getValue();
+    if (n.isNothing()) {
+        xstack.setNode(val.release());
+        return 0;
+    }
+
+    QoreHashNode* h = n.getType() == NT_HASH ? n.get<QoreHashNode>() : nullptr;
+    if (h) {
+        if (!xstack.getValueCount())
+            h->setKeyValue("^value^", val.release(), xsink);
+        else {
+            QoreString kstr;
+            kstr.sprintf("^value%d^", xstack.getValueCount());
+            h->setKeyValue(kstr.getBuffer(), val.release(), xsink);
+        }
+    }
+    else { // convert value to hash and save value node
+        h = new QoreHashNode(autoTypeInfo);
+        xstack.setNode(h);
+        h->setKeyValue("^value^", n, xsink);
+        xstack.incValueCount();
+
+        QoreString kstr;
+        kstr.sprintf("^value%d^", 1);
+        h->setKeyValue(kstr.getBuffer(), val.release(), xsink);
+    }
+    xstack.incValueCount();
+    return 0;
+}
+
+int QoreXmlDataBuilder::cdata(const char* str, size_t len, int depth) {
+    if (!typed_hashes.empty() && endTypedHashes(depth))
+        return -1;
+    if (skipped(depth) || (filter && !selected(depth)))
+        return 0;
+    if (inTypedHash(depth))
+        return unknownMember("CDATA", nullptr);
+    xstack.checkDepth(depth);
+    if (!str)
+        return 0;
+
+    QoreStringNode* val = getValue(str, len);
+    if (!val)
+        return -1;
+
+    QoreValue n = xstack.getValue();
+    if (n.getType() == NT_HASH) {
+        QoreHashNode* h = n.get<QoreHashNode>();
+        if (!xstack.getCDataCount())
+            h->setKeyValue("^cdata^", val, xsink);
+        else {
+            QoreString kstr;
+            kstr.sprintf("^cdata%d^", xstack.getCDataCount());
+            h->setKeyValue(kstr.getBuffer(), val, xsink);
+        }
+    }
+    else { // convert value to hash and save value node
+        QoreHashNode* h = new QoreHashNode(autoTypeInfo);
+        xstack.setNode(h);
+        if (!n.isNothing()) {
+            h->setKeyValue("^value^", n, xsink);
+            xstack.incValueCount();
+        }
+
+        h->setKeyValue("^cdata^", val, xsink);
+    }
+    xstack.incCDataCount();
+    return 0;
+}
+
+int QoreXmlDataBuilder::comment(const char* str, size_t len, int depth) {
+    if (!(pflags & XPF_ADD_COMMENTS))
+        return 0;
+    if (!typed_hashes.empty() && endTypedHashes(depth))
+        return -1;
+    // comments are not added to typed hashes
+    if (skipped(depth) || (filter && !selected(depth)) || inTypedHash(depth))
+        return 0;
+
+    xstack.checkDepth(depth);
+    if (!str)
+        return 0;
+
+    QoreStringNode* val = getValue(str, len);
+    if (!val)
+        return -1;
+
+    QoreValue n = xstack.getValue();
+    if (n.getType() == NT_HASH) {
+        QoreHashNode* h = n.get<QoreHashNode>();
+        if (!xstack.getCommentCount())
+            h->setKeyValue("^comment^", val, xsink);
+        else {
+            QoreString kstr;
+            kstr.sprintf("^comment%d^", xstack.getCommentCount());
+            h->setKeyValue(kstr.getBuffer(), val, xsink);
+        }
+    }
+    else { // convert value to hash and save value node
+        QoreHashNode* h = new QoreHashNode(autoTypeInfo);
+        xstack.setNode(h);
+        if (!n.isNothing()) {
+            h->setKeyValue("^value^", n, xsink);
+            xstack.incValueCount();
+        }
+
+        h->setKeyValue("^comment^", val, xsink);
+    }
+    xstack.incCommentCount();
+    return 0;
+}
+
+int QoreXmlDataBuilder::parseSax(ExceptionSink* xsink, const char* buf, size_t len, const char* encoding,
+        int options, const QoreEncoding* data_ccsid, int pflags, XmlDataOpts* dopts, const QoreString* xml,
+        QoreHashNode*& h, bool& unsupported_encoding, XmlSaxParserContext* reuse) {
+    QoreXmlDataBuilder builder(xsink, data_ccsid, pflags, dopts);
+    XmlSaxParser<QoreXmlDataBuilder> parser(builder, (bool)(pflags & XPF_STRIP_NS_PREFIXES));
+    int rc = parser.parse(buf, len, options, encoding, reuse);
+    if (!rc) {
+        QoreValue rv = builder.takeValue();
+        if (*xsink)
+            return -1;
+        // no element was selected
+        if (builder.filter && rv.isNothing()) {
+            h = new QoreHashNode(autoTypeInfo);
+            return 0;
+        }
+        if (rv.getType() != NT_HASH) {
+            rv.discard(xsink);
+            xsink->raiseExceptionArg("PARSE-XML-EXCEPTION", xml ? new QoreStringNode(*xml) : nullptr,
+                "parse error parsing XML string");
+            return -1;
+        }
+        h = rv.get<QoreHashNode>();
+        return 0;
+    }
+    if (rc < 0) {
+        if (!*xsink) {
+            QoreStringNode* desc = new QoreStringNode(parser.getError().c_str());
+            desc->chomp();
+            xsink->raiseException("PARSE-XML-EXCEPTION", desc);
+        }
+        return -1;
+    }
+    unsupported_encoding = parser.unsupportedEncoding();
+    return 1;
+}
+
+QoreHashNode* QoreXmlDataBuilder::parse(ExceptionSink* xsink, const QoreString& xml, const QoreEncoding* data_ccsid,
+        int pflags, XmlDataOpts* dopts) {
+    // strings in other encodings are decoded by libxml2 without converting them first
+    const QoreEncoding* enc = xml.getEncoding();
+    const char* encoding = enc == QCS_UTF8 ? nullptr : enc->getCode();
+
+    QoreHashNode* h = nullptr;
+    bool unsupported_encoding = false;
+    int rc = parseSax(xsink, xml.c_str(), xml.size(), encoding, QORE_XML_PARSER_OPTIONS, data_ccsid, pflags, dopts,
+        &xml, h, unsupported_encoding);
+    if (rc <= 0)
+        return h;
+
+    // the document is not supported by the SAX parser
+    if (!encoding) {
+        QoreXmlReader reader(&xml, QORE_XML_PARSER_OPTIONS, xsink);
+        if (!reader)
+            return nullptr;
+        return reader.parseXmlData(data_ccsid, pflags, xsink, dopts);
+    }
+    if (!unsupported_encoding && xml.size() <= INT_MAX) {
+        QoreXmlReader reader(xsink, xml.c_str(), (int)xml.size(), encoding,
+            QORE_XML_PARSER_OPTIONS | QORE_XML_PARSE_IGNORE_ENC, nullptr);
+        if (!reader || *xsink)
+            return nullptr;
+        return reader.parseXmlData(data_ccsid, pflags, xsink, dopts);
+    }
+
+    // libxml2 cannot decode the string; convert it to UTF-8
+    TempEncodingHelper str(xml, QCS_UTF8, xsink);
+    if (!str)
+        return nullptr;
+    QoreXmlReader reader(*str, QORE_XML_PARSER_OPTIONS, xsink);
+    if (!reader)
+        return nullptr;
+    return reader.parseXmlData(data_ccsid, pflags, xsink, dopts);
+}
+
+QoreHashNode* QoreXmlDataBuilder::parse(ExceptionSink* xsink, const char* buf, int size, const char* encoding,
+        int options, const QoreHashNode* opts, const QoreEncoding* data_ccsid, int pflags, XmlDataOpts* dopts,
+        XmlSaxParserContext* reuse) {
+    if (encoding)
+        options |= QORE_XML_PARSE_IGNORE_ENC;
+
+    if (!opts) {
+        QoreHashNode* h = nullptr;
+        bool unsupported_encoding = false;
+        int rc = parseSax(xsink, buf, size, encoding, options, data_ccsid, pflags, dopts, nullptr, h,
+            unsupported_encoding, reuse);
+        if (rc <= 0)
+            return h;
+    }
+
+    QoreXmlReader reader(xsink, buf, size, encoding, options, opts);
+    if (!reader || *xsink)
+        return nullptr;
+    return reader.parseXmlData(data_ccsid, pflags, xsink, dopts);
+}
+
+XmlHashDecl* XmlDataOpts::findHashDecl(const char* name, int depth) {
+    if (depth == hashdecl_depth && root_hd.hd)
+        return &root_hd;
+    // names without a namespace prefix match the local name
+    const char* p = strchr(name, ':');
+    const char* local = p ? p + 1 : name;
+    for (auto& i : hashdecls) {
+        if (i.first == (i.first.find(':') == std::string::npos ? local : name))
+            return &i.second;
+    }
+    return nullptr;
+}
+
+int XmlDataOpts::setHashDecl(ExceptionSink* xsink, const char* err, const char* opt, const QoreValue v,
+        XmlHashDecl& decl) {
+    const TypedHashDecl* hd = v.getType() == NT_HASH ? v.get<const QoreHashNode>()->getHashDecl() : nullptr;
+    if (!hd) {
+        xsink->raiseException(err, "expecting a typed hash with option '%s'; got type '%s' instead", opt,
+            v.getTypeName());
+        return -1;
+    }
+    decl.hd = hd;
+    return 0;
+}
+
+int XmlDataOpts::set(ExceptionSink* xsink, const char* err, const char* key, const QoreValue v) {
+    if (!strcmp(key, "select"))
+        return setSelect(xsink, err, v);
+    if (!strcmp(key, "hashdecl"))
+        return setHashDecl(xsink, err, key, v, root_hd);
+    if (!strcmp(key, "reject_unknown")) {
+        reject_unknown = v.getAsBool();
+        return 0;
+    }
+    if (!strcmp(key, "hashdecls")) {
+        if (v.getType() != NT_HASH) {
+            xsink->raiseException(err, "expecting type 'hash' with option 'hashdecls'; got type '%s' instead",
+                v.getTypeName());
+            return -1;
+        }
+        ConstHashIterator i(v.get<const QoreHashNode>());
+        while (i.next()) {
+            hashdecls.push_back(std::make_pair(std::string(i.getKey()), XmlHashDecl()));
+            if (setHashDecl(xsink, err, key, i.get(), hashdecls.back().second))
+                return -1;
+        }
+        return 0;
+    }
+    if (strcmp(key, "types"))
+        return 1;
+
+    if (v.getType() != NT_HASH) {
+        xsink->raiseException(err, "expecting type 'hash' with option 'types'; got type '%s' instead",
+            v.getTypeName());
+        return -1;
+    }
+    ConstHashIterator i(v.get<const QoreHashNode>());
+    while (i.next()) {
+        QoreValue t = i.get();
+        if (t.getType() != NT_STRING) {
+            xsink->raiseException(err, "expecting type 'string' for path '%s' with option 'types'; got type '%s' "
+                "instead", i.getKey(), t.getTypeName());
+            return -1;
+        }
+        const char* name = t.get<const QoreStringNode>()->c_str();
+        int ti = QoreXmlDataBuilder::findType(name);
+        if (ti < 0) {
+            xsink->raiseException(err, "unsupported type '%s' for path '%s' with option 'types'", name, i.getKey());
+            return -1;
+        }
+        if (types.add(i.getKey(), ti)) {
+            xsink->raiseException(err, "invalid path '%s' with option 'types'", i.getKey());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int XmlDataOpts::setSelect(ExceptionSink* xsink, const char* err, const QoreValue v) {
+    if (v.getType() == NT_STRING) {
+        const QoreStringNode* str = v.get<const QoreStringNode>();
+        if (select.add(str->c_str())) {
+            xsink->raiseException(err, "invalid path '%s' with option 'select'", str->c_str());
+            return -1;
+        }
+        return 0;
+    }
+    if (v.getType() != NT_LIST) {
+        xsink->raiseException(err, "expecting type 'string' or 'list' with option 'select'; got type '%s' instead",
+            v.getTypeName());
+        return -1;
+    }
+    const QoreListNode* l = v.get<const QoreListNode>();
+    for (size_t i = 0; i < l->size(); ++i) {
+        QoreValue p = l->retrieveEntry(i);
+        if (p.getType() != NT_STRING) {
+            xsink->raiseException(err, "expecting type 'string' for element %d of option 'select'; got type '%s' "
+                "instead", (int)i, p.getTypeName());
+            return -1;
+        }
+        if (setSelect(xsink, err, p))
+            return -1;
+    }
+    return 0;
+}
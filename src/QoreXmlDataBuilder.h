@@ -0,0 +1,360 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    QoreXmlDataBuilder.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_QOREXMLDATABUILDER_H
+
+#define _QORE_QOREXMLDATABUILDER_H
+
+#include "qore-xml-module.h"
+#include "QoreXmlRpcReader.h"
+#include "XmlTranscode.h"
+#include "XmlPathFilter.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class XmlSaxParserContext;
+
+//! the types that element values can be converted to while parsing
+enum XmlValueType {
+    XVT_STRING,   //!< the value is not converted
+    XVT_INT,      //!< integer types
+    XVT_FLOAT,    //!< \c xsd:float, \c xsd:double
+    XVT_NUMBER,   //!< \c xsd:decimal
+    XVT_BOOL,     //!< \c xsd:boolean
+    XVT_DATE,     //!< \c xsd:date
+    XVT_DATETIME, //!< \c xsd:dateTime
+    XVT_DATE_ANY, //!< \c xsd:date or \c xsd:dateTime
+    XVT_TIME,     //!< \c xsd:time
+    XVT_BASE64,   //!< \c xsd:base64Binary
+    XVT_HEX,      //!< \c xsd:hexBinary
+};
+
+//! a hashdecl for the values of elements
+struct XmlHashDecl {
+    const TypedHashDecl* hd = nullptr;
+    //! the members looked up, with the index in the type table of the type that strings are converted to or -1
+    std::vector<std::pair<const QoreExternalMemberBase*, int>> conversions;
+};
+
+/**
+ * Options for converting XML documents to Qore data, as given with the \c select, \c types, \c hashdecl,
+ * \c hashdecls and \c reject_unknown options of parse_xml(), parse_xml_file(), XmlDoc::toQore(),
+ * XmlDoc::toQoreData() and SaxIterator.
+ */
+class XmlDataOpts {
+public:
+    //! selects the elements to add; if empty, all elements are added
+    XmlPathFilter select;
+    //! the paths of typed elements; the tag of each path is an index in the type table of QoreXmlDataBuilder
+    XmlPathFilter types;
+    //! the hashdecl for elements at hashdecl_depth; by default the root element
+    XmlHashDecl root_hd;
+    //! the depth of the elements that root_hd is used for
+    int hashdecl_depth = 0;
+    //! hashdecls for elements by name
+    std::vector<std::pair<std::string, XmlHashDecl>> hashdecls;
+    //! if true, elements and attributes that are not members of a hashdecl raise an exception
+    bool reject_unknown = false;
+
+    /**
+     * Processes an option.
+     * @param err the exception code for invalid values
+     * @returns 0 = OK, 1 = the option is not supported, -1 = error (exception raised)
+     */
+    DLLLOCAL int set(ExceptionSink* xsink, const char* err, const char* key, const QoreValue v);
+
+    //! returns a pointer to this object if any option is set, otherwise nullptr
+    DLLLOCAL XmlDataOpts* get() {
+        return select.empty() && types.empty() && !hasHashDecls() ? nullptr : this;
+    }
+
+    //! returns true if any hashdecl is set
+    DLLLOCAL bool hasHashDecls() const {
+        return root_hd.hd || !hashdecls.empty();
+    }
+
+    //! returns the hashdecl for the element or nullptr if the element has none
+    DLLLOCAL XmlHashDecl* findHashDecl(const char* name, int depth);
+
+private:
+    //! adds the paths of the \c select option
+    DLLLOCAL int setSelect(ExceptionSink* xsink, const char* err, const QoreValue v);
+
+    //! sets the hashdecl from a typed hash
+    DLLLOCAL static int setHashDecl(ExceptionSink* xsink, const char* err, const char* opt, const QoreValue v,
+            XmlHashDecl& decl);
+};
+
+/**
+ * Builds the data structure returned by parse_xml() from the nodes of an XML document.
+ *
+ * Nodes are passed in document order with the depth reported by xmlTextReader; the same builder is used when
+ * reading the document with QoreXmlReader and when parsing it with XmlSaxParser, so both produce the same result.
+ * All names and strings are expected in UTF-8 encoding; element names must remain valid until the value has been
+ * taken.
+ *
+ * With the \c select option, only the selected elements with their subtrees are added, together with the names of
+ * their ancestors; the attributes, text and other children of ancestors are not added.  With the \c types option,
+ * the text of the typed elements is converted to the given types as it is read.  Elements with a hashdecl are
+ * built as typed hashes in place: child elements and attributes are assigned to the members with the same local
+ * name, converted to the member types, and others are skipped or rejected.
+ */
+class QoreXmlDataBuilder {
+public:
+    DLLLOCAL QoreXmlDataBuilder(ExceptionSink* xsink, const QoreEncoding* data_ccsid, int pflags,
+            XmlDataOpts* dopts = nullptr)
+            : xsink(xsink), data_ccsid(data_ccsid), pflags(pflags), attrs(xsink) {
+        if (dopts) {
+            if (dopts->hasHashDecls())
+                this->dopts = dopts;
+            if (!dopts->select.empty()) {
+                filter = &dopts->select;
+                filter->reset();
+            }
+            if (!dopts->types.empty()) {
+                types = &dopts->types;
+                types->reset();
+            }
+        }
+    }
+
+    DLLLOCAL ~QoreXmlDataBuilder();
+
+    /**
+     * Processes an element.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int element(const char* name, int depth);
+
+    //! returns true if the subtree of the last element is not selected and can be skipped
+    DLLLOCAL bool skipSubtree() const {
+        return skip_depth >= 0;
+    }
+
+    /**
+     * Adds an attribute to the last element.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int attribute(const char* name, const char* value, size_t len);
+
+    /**
+     * Sets the attributes of the last element; called after the last attribute.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int endAttributes();
+
+    /**
+     * Processes a text node; \a str may be nullptr.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int text(const char* str, size_t len, int depth);
+
+    /**
+     * Processes a CDATA node; \a str may be nullptr.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int cdata(const char* str, size_t len, int depth);
+
+    /**
+     * Processes a comment; comments are ignored unless XPF_ADD_COMMENTS is set.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int comment(const char* str, size_t len, int depth);
+
+    //! returns the value built; returns an empty value if an exception was raised
+    DLLLOCAL QoreValue takeValue();
+
+    /**
+     * Parses an XML string to a hash as returned by parse_xml().
+     *
+     * The string is parsed with XmlSaxParser; documents it does not support are read with QoreXmlReader.  Strings in
+     * other encodings than UTF-8 are decoded by libxml2 in the encoding of the string, which takes precedence over
+     * any encoding in the XML declaration; they are only converted to UTF-8 first if libxml2 does not know the
+     * encoding.
+     * @returns the hash or nullptr if an exception was raised
+     */
+    DLLLOCAL static QoreHashNode* parse(ExceptionSink* xsink, const QoreString& xml, const QoreEncoding* data_ccsid,
+            int pflags, XmlDataOpts* dopts = nullptr);
+
+    /**
+     * Parses an XML document in a buffer, such as a memory-mapped file, to a hash as returned by parse_xml().
+     *
+     * The document is parsed in place with XmlSaxParser, unless reader options are given or the document is not
+     * supported; then it is read from the buffer with QoreXmlReader.
+     * @param encoding the encoding of the document overriding any XML declaration, or nullptr
+     * @param options libxml2 parser options
+     * @param opts QoreXmlReader options (\c xsd, \c xml_input_io), or nullptr
+     * @param reuse a parser context to parse the document with XmlSaxParser, or nullptr to use a new context
+     * @returns the hash or nullptr if an exception was raised
+     */
+    DLLLOCAL static QoreHashNode* parse(ExceptionSink* xsink, const char* buf, int size, const char* encoding,
+            int options, const QoreHashNode* opts, const QoreEncoding* data_ccsid, int pflags,
+            XmlDataOpts* dopts = nullptr, XmlSaxParserContext* reuse = nullptr);
+
+    //! returns the index of the type with the given name in the type table, or -1 if the type is not supported
+    DLLLOCAL static int findType(const char* name);
+
+private:
+    ExceptionSink* xsink;
+    const QoreEncoding* data_ccsid;
+    int pflags;
+    Qore::Xml::intern::xml_stack xstack;
+    //! the attributes of the last element
+    ReferenceHolder<QoreHashNode> attrs;
+    //! converts strings to the output encoding; one conversion descriptor is used for all strings in the document
+    std::unique_ptr<XmlTranscoder> transcoder;
+
+    //! selects the elements to add; nullptr = all elements are added
+    XmlPathFilter* filter = nullptr;
+    //! the depth of the selected element whose subtree is being added, or -1
+    int select_depth = -1;
+    //! the depth of the element whose subtree is being skipped, or -1
+    int skip_depth = -1;
+
+    //! an ancestor of selected elements
+    struct Ancestor {
+        const char* name;
+        int depth;
+        //! true if the element has been added
+        bool added;
+    };
+    //! the open ancestor elements
+    std::vector<Ancestor> ancestors;
+
+    //! the paths of typed elements, or nullptr
+    XmlPathFilter* types = nullptr;
+    //! the depth of the typed element being read, or -1
+    int type_depth = -1;
+    //! the depth of the element whose subtree has no typed elements, or -1
+    int type_skip_depth = -1;
+    //! the index of the type of the element at type_depth in the type table
+    int type_index = 0;
+    //! the name of the element at type_depth
+    const char* type_element = nullptr;
+
+    //! matches the element against the typed paths
+    DLLLOCAL void typeElement(const char* name, int depth);
+
+    //! returns true if the text at the given depth is the value of a typed element
+    DLLLOCAL bool typed(int depth) const {
+        return type_depth >= 0 && depth == type_depth + 1;
+    }
+
+    //! returns the value converted to the type of the current element; returns an empty value on error
+    DLLLOCAL QoreValue getTypedValue(const char* str, size_t len) {
+        return convertValue(type_index, type_element, str, len);
+    }
+
+    //! the options if hashdecls are set, otherwise nullptr
+    XmlDataOpts* dopts = nullptr;
+    //! a typed hash being built
+    struct TypedHash {
+        QoreHashNode* h;
+        XmlHashDecl* decl;
+        int depth;
+        //! the members set from the document with their default values
+        std::vector<std::pair<const QoreExternalMemberBase*, QoreValue>> set;
+    };
+    //! the open typed hashes
+    std::vector<TypedHash> typed_hashes;
+    //! true if the last element is a typed hash
+    bool typed_element = false;
+
+    //! returns true if nodes at the given depth are in a skipped subtree
+    DLLLOCAL bool skipped(int depth) const {
+        return skip_depth >= 0 && depth > skip_depth;
+    }
+
+    //! returns true if nodes at the given depth are children of a typed hash
+    DLLLOCAL bool inTypedHash(int depth) const {
+        return !typed_hashes.empty() && typed_hashes.back().depth == depth - 1;
+    }
+
+    //! returns true if nodes at the given depth are in the subtree of a selected element
+    DLLLOCAL bool selected(int depth) const {
+        return select_depth >= 0 && depth > select_depth;
+    }
+
+    //! returns true if the element is added
+    DLLLOCAL bool filterElement(const char* name, int depth);
+
+    DLLLOCAL void addElement(const char* name, int depth);
+
+    /**
+     * Adds an element as a member of the current typed hash.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int addMember(const char* name, int depth);
+
+    /**
+     * Makes the value of the element a typed hash if it has a hashdecl.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int startTypedHash(const char* name, int depth);
+
+    /**
+     * Checks the members of typed hashes at the given depth or deeper, which have been completed.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int endTypedHashes(int depth);
+
+    /**
+     * Handles a node that is not a member of the current typed hash.
+     * @returns 0 = the node is skipped, -1 = error (exception raised)
+     */
+    DLLLOCAL int unknownMember(const char* type, const char* name);
+
+    /**
+     * Finds the member of the current typed hash for an element or attribute.
+     * @param conv set to the index of the type that string values are converted to, or -1
+     * @returns the member or nullptr if there is none
+     */
+    DLLLOCAL const QoreExternalMemberBase* findMember(const char* name, int& conv);
+
+    /**
+     * Returns the value of a member of the current typed hash to set; the default value of the member is restored
+     * if it is not set.  If the member has already been set, then its values are returned in a list, and a new list
+     * entry is returned.
+     */
+    DLLLOCAL QoreValue& setMember(const QoreExternalMemberBase* m);
+
+    //! returns the value converted to the type with the given index in the type table; returns an empty value on error
+    DLLLOCAL QoreValue convertValue(int type, const char* element, const char* str, size_t len);
+
+    //! returns a string in the output encoding or nullptr if an exception was raised
+    DLLLOCAL QoreStringNode* getValue(const char* str, size_t len);
+
+    /**
+     * Parses a document with XmlSaxParser.
+     * @param xml the document string for exception arguments, or nullptr
+     * @returns 0 = OK (\a h set), -1 = error (exception raised), 1 = the document must be read with QoreXmlReader
+     */
+    DLLLOCAL static int parseSax(ExceptionSink* xsink, const char* buf, size_t len, const char* encoding, int options,
+            const QoreEncoding* data_ccsid, int pflags, XmlDataOpts* dopts, const QoreString* xml, QoreHashNode*& h,
+            bool& unsupported_encoding, XmlSaxParserContext* reuse = nullptr);
+};
+
+#endif
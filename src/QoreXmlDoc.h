@@ -47,6 +47,13 @@
 #define QORE_XML_PARSER_OPTIONS XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_NOBLANKS QORE_XML_PARSER_OPTIONS_ADDONS
 #endif
 
+// ignores the encoding in the XML declaration when the encoding of the document is given explicitly
+#if LIBXML_VERSION >= 20800
+#define QORE_XML_PARSE_IGNORE_ENC XML_PARSE_IGNORE_ENC
+#else
+#define QORE_XML_PARSE_IGNORE_ENC 0
+#endif
+
 DLLLOCAL QoreStringNode *doString(xmlChar *str);
 class QoreXmlNodeData;
 class QoreXmlDocData;
@@ -54,8 +61,8 @@ DLLLOCAL QoreXmlNodeData *doNode(xmlNodePtr p, QoreXmlDocData *doc);
 
 class QoreXmlDoc {
 private:
-   DLLLOCAL void init(const char *buf, int size, const char *encoding = 0) {
-      ptr = xmlReadMemory(buf, size, 0, encoding, QORE_XML_PARSER_OPTIONS);
+   DLLLOCAL void init(const char *buf, int size, const char *encoding = 0, int options = QORE_XML_PARSER_OPTIONS) {
+      ptr = xmlReadMemory(buf, size, 0, encoding, options);
    }
 
 protected:
@@ -65,12 +72,19 @@ public:
    DLLLOCAL QoreXmlDoc(const char *buf, int size) {
       init(buf, size);
    }
+   // the buffer is only used while parsing
+   DLLLOCAL QoreXmlDoc(const char *buf, int size, const char *encoding, int options) {
+      init(buf, size, encoding, options);
+   }
    DLLLOCAL QoreXmlDoc(const QoreString &xml) {
       init(xml.getBuffer(), xml.strlen(), xml.getEncoding()->getCode());
    }
    DLLLOCAL QoreXmlDoc(const QoreString *xml) {
       init(xml->getBuffer(), xml->strlen(), xml->getEncoding()->getCode());
    }
+   // takes ownership of the document
+   DLLLOCAL QoreXmlDoc(xmlDocPtr doc) : ptr(doc) {
+   }
    DLLLOCAL QoreXmlDoc(const QoreXmlDoc &orig) {
       ptr = orig.ptr ? xmlCopyDoc(orig.ptr, 1) : 0;
    }
@@ -24,29 +24,11 @@
 #include <qore/Qore.h>
 #include "QoreXmlReader.h"
 #include "QoreXmlRpcReader.h"
+#include "QoreXmlDataBuilder.h"
 
 #include <memory>
 
-static bool keys_are_equal(const char* k1, const char* k2, bool &get_value) {
-    while (true) {
-        if (!(*k1)) {
-            if (!(*k2))
-                return true;
-            if ((*k2) == '^') {
-                get_value = true;
-                return true;
-            }
-            return false;
-        }
-        if ((*k1) != (*k2))
-            break;
-        k1++;
-        k2++;
-    }
-    return false;
-}
-
-void QoreXmlReader::processOpts(const QoreHashNode* opts, ExceptionSink* xsink) {
+void QoreXmlReader::processOpts(const QoreHashNode* opts, ExceptionSink* xsink, bool enc_opt) {
     assert(reader);
     if (!opts)
         return;
@@ -88,7 +70,8 @@ void QoreXmlReader::processOpts(const QoreHashNode* opts, ExceptionSink* xsink)
         }
 
         // ignore options already processed
-        if (!strcmp(key, "encoding") || !strcmp(key, "xml_parse_options") || !strcmp(key, "xml_input_io"))
+        if ((enc_opt && !strcmp(key, "encoding")) || !strcmp(key, "xml_parse_options") || !strcmp(key, "xml_input_io")
+            || !strcmp(key, "hashdecl") || !strcmp(key, "hashdecls") || !strcmp(key, "reject_unknown"))
             continue;
 
         xsink->raiseException("XML-READER-ERROR", "unsupported option '%s'", key);
@@ -96,11 +79,16 @@ void QoreXmlReader::processOpts(const QoreHashNode* opts, ExceptionSink* xsink)
     }
 }
 
-QoreHashNode* QoreXmlReader::parseXmlData(const QoreEncoding* data_ccsid, int pflags, ExceptionSink* xsink) {
+QoreHashNode* QoreXmlReader::parseXmlData(const QoreEncoding* data_ccsid, int pflags, ExceptionSink* xsink, XmlDataOpts* dopts) {
     if (read(xsink) != 1)
         return 0;
 
-    QoreValue rv = getXmlData(xsink, data_ccsid, pflags, depth());
+    QoreValue rv = getXmlData(xsink, data_ccsid, pflags, depth(), dopts);
+
+    // no element was selected in a document that was read completely without errors
+    if (dopts && !dopts->select.empty() && rv.isNothing() && !*xsink
+        && xmlTextReaderReadState(reader) == XML_TEXTREADER_MODE_EOF)
+        return new QoreHashNode(autoTypeInfo);
 
     if (!rv) {
         if (!*xsink)
@@ -112,8 +100,8 @@ QoreHashNode* QoreXmlReader::parseXmlData(const QoreEncoding* data_ccsid, int pf
     return rv.get<QoreHashNode>();
 }
 
-QoreValue QoreXmlReader::getXmlData(ExceptionSink* xsink, const QoreEncoding* data_ccsid, int pflags, int min_depth) {
-    Qore::Xml::intern::xml_stack xstack;
+QoreValue QoreXmlReader::getXmlData(ExceptionSink* xsink, const QoreEncoding* data_ccsid, int pflags, int min_depth, XmlDataOpts* dopts) {
+    QoreXmlDataBuilder builder(xsink, data_ccsid, pflags, dopts);
 
     QORE_TRACE("getXMLData()");
     //printd(5, "QoreXmlReader::getXmlData() enc: %s flags: %d md: %d\n", data_ccsid->getCode(), pflags, min_depth);
@@ -135,204 +123,43 @@ QoreValue QoreXmlReader::getXmlData(ExceptionSink* xsink, const QoreEncoding* da
             break;
 
         if (nt == XML_READER_TYPE_ELEMENT) {
-            int depth = QoreXmlReader::depth();
-            xstack.checkDepth(depth);
-
-            QoreValue n = xstack.getValue();
-            // if there is no node pointer, then make a hash
-            if (n.isNothing()) {
-                QoreHashNode* h = new QoreHashNode(autoTypeInfo);
-                xstack.setNode(h);
-                xstack.push(h->getKeyValueReference(name), depth);
-            }
-            else { // node ptr already exists
-                QoreHashNode* h = n.getType() == NT_HASH ? n.get<QoreHashNode>() : nullptr;
-                if (!h) {
-                    h = new QoreHashNode(autoTypeInfo);
-                    xstack.setNode(h);
-                    h->setKeyValue("^value^", n, xsink);
-                    xstack.incValueCount();
-                    xstack.push(h->getKeyValueReference(name), depth);
-                }
-                else {
-                    // see if key already exists
-                    QoreValue v;
-                    bool exists;
-                    v = h->getKeyValueExistence(name, exists);
-
-                    if (!exists)
-                        xstack.push(h->getKeyValueReference(name), depth);
-                    else {
-                        if (!(pflags & XPF_PRESERVE_ORDER)) {
-                            QoreListNode* vl = v.getType() == NT_LIST ? v.get<QoreListNode>() : nullptr;
-                            // if it's not a list, then make into a list with current value as first entry
-                            if (!vl) {
-                                QoreValue& vp = h->getKeyValueReference(name);
-                                vl = new QoreListNode(autoTypeInfo);
-                                vl->push(v, xsink);
-                                vp = vl;
-                            }
-                            xstack.push(vl->getEntryReference(vl->size()), depth);
-                        }
-                        else {
-                            // see if last key was the same, if so make a list if it's not
-                            const char* lk = h->getLastKey();
-                            bool get_value = false;
-                            if (keys_are_equal(name, lk, get_value)) {
-                                // get actual key value if there was a suffix
-                                if (get_value)
-                                    v = h->getKeyValue(lk);
-
-                                QoreListNode* vl = v.getType() == NT_LIST ? v.get<QoreListNode>() : nullptr;
-                                // if it's not a list, then make into a list with current value as first entry
-                                if (!vl) {
-                                    QoreValue& vp = h->getKeyValueReference(lk);
-                                    vl = new QoreListNode(autoTypeInfo);
-                                    vl->push(v, xsink);
-                                    vp = vl;
-                                }
-                                xstack.push(vl->getEntryReference(vl->size()), depth);
-                            }
-                            else {
-                                QoreString ns;
-                                int c = 1;
-                                while (true) {
-                                    ns.sprintf("%s^%d", name, c);
-                                    if (!h->existsKey(ns.c_str()))
-                                        break;
-                                    c++;
-                                    ns.clear();
-                                }
-                                xstack.push(h->getKeyValueReference(ns.c_str()), depth);
-                            }
-                        }
-                    }
+            if (builder.element(name, depth()))
+                return QoreValue();
+            // skip the subtrees of elements that are not selected
+            if (builder.skipSubtree()) {
+                rc = xmlTextReaderNext(reader);
+                if (min_depth > 0 && QoreXmlReader::depth() < min_depth) {
+                    rc = 0;
+                    break;
                 }
+                continue;
             }
+
             // add attributes to structure if possible
             if (hasAttributes()) {
-                ReferenceHolder<QoreHashNode> h(new QoreHashNode(autoTypeInfo), xsink);
                 while (moveToNextAttribute(xsink) == 1) {
-                    const char* aname = constName();
-                    QoreStringNode* value = getValue(data_ccsid, xsink);
-                    if (!value)
+                    const char* value = constValue();
+                    if (builder.attribute(constName(), value ? value : "", value ? strlen(value) : 0))
                         return QoreValue();
-                    h->setKeyValue(aname, value, xsink);
                 }
-                if (*xsink)
+                if (builder.endAttributes())
                     return QoreValue();
-
-                // make new new a hash and assign "^attributes^" key
-                QoreHashNode* nv = new QoreHashNode(autoTypeInfo);
-                nv->setKeyValue("^attributes^", h.release(), xsink);
-                xstack.setNode(nv);
             }
             //printd(5, "%s: type: %d, hasValue: %d, empty: %d, depth: %d\n", name, nt, xmlTextReaderHasValue(reader), xmlTextReaderIsEmptyElement(reader), depth);
         }
         else if (nt == XML_READER_TYPE_TEXT) {
-            int depth = QoreXmlReader::depth();
-            xstack.checkDepth(depth);
-
             const char* str = constValue();
-            if (str) {
-                QoreStringNodeHolder val(getValue(data_ccsid, xsink));
-                if (!val)
-                    return QoreValue();
-
-                QoreValue n = xstack.getValue();
-                if (!n.isNothing()) {
-                    QoreHashNode* h = n.getType() == NT_HASH ? n.get<QoreHashNode>() : nullptr;
-                    if (h) {
-                        if (!xstack.getValueCount())
-                            h->setKeyValue("^value^", val.release(), xsink);
-                        else {
-                            QoreString kstr;
-                            kstr.sprintf("^value%d^", xstack.getValueCount());
-                            h->setKeyValue(kstr.getBuffer(), val.release(), xsink);
-                        }
-                    }
-                    else { // convert value to hash and save value node
-                        h = new QoreHashNode(autoTypeInfo);
-                        xstack.setNode(h);
-                        h->setKeyValue("^value^", n, xsink);
-                        xstack.incValueCount();
-
-                        QoreString kstr;
-                        kstr.sprintf("^value%d^", 1);
-                        h->setKeyValue(kstr.getBuffer(), val.release(), xsink);
-                    }
-                    xstack.incValueCount();
-                }
-                else
-                xstack.setNode(val.release());
-            }
+            if (builder.text(str, str ? strlen(str) : 0, depth()))
+                return QoreValue();
         }
         else if (nt == XML_READER_TYPE_CDATA) {
-            int depth = QoreXmlReader::depth();
-            xstack.checkDepth(depth);
-
             const char* str = constValue();
-            if (str) {
-                QoreStringNode* val = getValue(data_ccsid, xsink);
-                if (!val)
-                    return QoreValue();
-
-                QoreValue n = xstack.getValue();
-                if (n.getType() == NT_HASH) {
-                    QoreHashNode* h = n.get<QoreHashNode>();
-                    if (!xstack.getCDataCount())
-                        h->setKeyValue("^cdata^", val, xsink);
-                    else {
-                        QoreString kstr;
-                        kstr.sprintf("^cdata%d^", xstack.getCDataCount());
-                        h->setKeyValue(kstr.getBuffer(), val, xsink);
-                    }
-                }
-                else { // convert value to hash and save value node
-                    QoreHashNode* h = new QoreHashNode(autoTypeInfo);
-                    xstack.setNode(h);
-                    if (!n.isNothing()) {
-                        h->setKeyValue("^value^", n, xsink);
-                        xstack.incValueCount();
-                    }
-
-                    h->setKeyValue("^cdata^", val, xsink);
-                }
-                xstack.incCDataCount();
-            }
-        } else if (nt == XML_READER_TYPE_COMMENT && (pflags & XPF_ADD_COMMENTS)) {
-            int depth = QoreXmlReader::depth();
-            xstack.checkDepth(depth);
-
+            if (builder.cdata(str, str ? strlen(str) : 0, depth()))
+                return QoreValue();
+        } else if (nt == XML_READER_TYPE_COMMENT) {
             const char* str = constValue();
-            if (str) {
-                QoreStringNode* val = getValue(data_ccsid, xsink);
-                if (!val)
-                    return QoreValue();
-
-                QoreValue n = xstack.getValue();
-                if (n.getType() == NT_HASH) {
-                    QoreHashNode* h = n.get<QoreHashNode>();
-                    if (!xstack.getCommentCount())
-                        h->setKeyValue("^comment^", val, xsink);
-                    else {
-                        QoreString kstr;
-                        kstr.sprintf("^comment%d^", xstack.getCommentCount());
-                        h->setKeyValue(kstr.getBuffer(), val, xsink);
-                    }
-                }
-                else { // convert value to hash and save value node
-                    QoreHashNode* h = new QoreHashNode(autoTypeInfo);
-                    xstack.setNode(h);
-                    if (!n.isNothing()) {
-                        h->setKeyValue("^value^", n, xsink);
-                        xstack.incValueCount();
-                    }
-
-                    h->setKeyValue("^comment^", val, xsink);
-                }
-                xstack.incCommentCount();
-            }
+            if (builder.comment(str, str ? strlen(str) : 0, depth()))
+                return QoreValue();
         }
         rc = read();
 
@@ -341,5 +168,5 @@ QoreValue QoreXmlReader::getXmlData(ExceptionSink* xsink, const QoreEncoding* da
             break;
         }
     }
-    return rc ? QoreValue() : xstack.takeValue();
+    return rc ? QoreValue() : builder.takeValue();
 }
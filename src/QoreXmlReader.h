@@ -34,6 +34,8 @@
 
 #include <errno.h>
 
+class XmlDataOpts;
+
 // FIXME: need to make error reporting consistent and set ExceptionSink for each call, not in constructor and then fix ql_xml.cc and adjust QC_XmlReader.cc
 
 class XmlIoInputCallbackHelper {
@@ -112,7 +114,7 @@ protected:
         return 0;
     }
 
-    DLLLOCAL QoreValue getXmlData(ExceptionSink* xsink, const QoreEncoding* data_ccsid, int pflags = XPF_NONE, int min_depth = -1);
+    DLLLOCAL QoreValue getXmlData(ExceptionSink* xsink, const QoreEncoding* data_ccsid, int pflags = XPF_NONE, int min_depth = -1, XmlDataOpts* dopts = nullptr);
 
     DLLLOCAL void init(const char* enc, int options, const QoreHashNode* opts, ExceptionSink* xsink) {
         assert(!xml);
@@ -126,8 +128,9 @@ protected:
 
         xmlTextReaderSetErrorHandler(reader, (xmlTextReaderErrorFunc)qore_xml_error_func, this);
 
+        // the encoding is taken from the "encoding" option by the caller
         if (opts)
-            processOpts(opts, xsink);
+            processOpts(opts, xsink, true);
         //printd(5, "QoreXmlReader::init() valid: %d\n", isValid());
     }
 
@@ -150,7 +153,8 @@ protected:
             processOpts(opts, xsink);
     }
 
-    DLLLOCAL void processOpts(const QoreHashNode* opts, ExceptionSink* xsink);
+    //! processes reader options; "encoding" is only accepted if \a enc_opt is true, meaning that the caller used it
+    DLLLOCAL void processOpts(const QoreHashNode* opts, ExceptionSink* xsink, bool enc_opt = false);
 
     DLLLOCAL void init(xmlDocPtr doc, ExceptionSink* xsink) {
         assert(!xml);
@@ -186,6 +190,22 @@ protected:
         xmlTextReaderSetErrorHandler(reader, (xmlTextReaderErrorFunc)qore_xml_error_func, this);
         //printd(5, "QoreXmlReader::init() opts: %p reader: %p set error handler\n", opts, reader);
 
+        // the encoding is taken from the "encoding" option by the caller
+        if (opts)
+            processOpts(opts, xsink, true);
+    }
+
+    DLLLOCAL void init(ExceptionSink* xsink, const char* buf, int size, const char* encoding, int options, const QoreHashNode* opts) {
+        assert(!xml);
+        assert(!reader);
+        reader = xmlReaderForMemory(buf, size, 0, encoding, options);
+        if (!reader) {
+            xsink->raiseException("XML-READER-ERROR", "could not create XML reader");
+            return;
+        }
+
+        xmlTextReaderSetErrorHandler(reader, (xmlTextReaderErrorFunc)qore_xml_error_func, this);
+
         if (opts)
             processOpts(opts, xsink);
     }
@@ -215,10 +235,6 @@ protected:
             init(xsink, n_xml, options, doc);
     }
 
-    DLLLOCAL QoreXmlReader(ExceptionSink* xsink, const char* fn, const char* encoding, int options, const QoreHashNode* opts) : inputStream(xsink) {
-        init(xsink, fn, encoding, options, opts);
-    }
-
     DLLLOCAL void reset(ExceptionSink* xsink, const QoreString* n_xml, int options, xmlDocPtr doc) {
         reset();
         init(xsink, n_xml, options, doc);
@@ -268,6 +284,15 @@ public:
         init(doc, xsink);
     }
 
+    DLLLOCAL QoreXmlReader(ExceptionSink* xsink, const char* fn, const char* encoding, int options, const QoreHashNode* opts) : inputStream(xsink) {
+        init(xsink, fn, encoding, options, opts);
+    }
+
+    //! reads the document from a buffer that must remain valid for the lifetime of the object
+    DLLLOCAL QoreXmlReader(ExceptionSink* xsink, const char* buf, int size, const char* encoding, int options, const QoreHashNode* opts) : xs(xsink), inputStream(xsink) {
+        init(xsink, buf, size, encoding, options, opts);
+    }
+
     DLLLOCAL ~QoreXmlReader() {
         reset();
     }
@@ -572,7 +597,8 @@ public:
     }
 #endif
 
-    DLLLOCAL QoreHashNode* parseXmlData(const QoreEncoding* data_ccsid, int pflags, ExceptionSink* xsink);
+    //! parses the document; with the select option, only the selected elements are added and subtrees of other elements are skipped
+    DLLLOCAL QoreHashNode* parseXmlData(const QoreEncoding* data_ccsid, int pflags, ExceptionSink* xsink, XmlDataOpts* dopts = nullptr);
 };
 
 #endif
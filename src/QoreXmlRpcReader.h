@@ -25,6 +25,7 @@
 #define _QORE_QOREXMLRPCREADER_H
 
 #include "QoreXmlReader.h"
+#include "XmlElementStack.h"
 
 namespace Qore {
 namespace Xml {
@@ -65,22 +66,9 @@ namespace intern { // make classes local
         }
     };
 
-    class xml_node {
-    public:
-        QoreValue& node;
-        xml_node* next = nullptr;
-        int depth;
-        int vcount = 0;
-        int cdcount = 0;
-        int commentcount = 0;
-
-        DLLLOCAL xml_node(QoreValue& n, int d) : node(n), depth(d) {
-        }
-    };
-
     class xml_stack {
     private:
-        xml_node* tail = nullptr;
+        XmlElementStack<QoreValue> stack;
         QoreValue val;
 
     public:
@@ -90,34 +78,24 @@ namespace intern { // make classes local
 
         DLLLOCAL ~xml_stack() {
             val.discard(nullptr);
-
-            while (tail) {
-                //printd(5, "xml_stack::~xml_stack(): deleting: %p (%d), next: %p\n", tail, tail->depth, tail->next);
-                xml_node* n = tail->next;
-                delete tail;
-                tail = n;
-            }
         }
 
         DLLLOCAL void checkDepth(int depth) {
-            while (tail && depth && tail->depth >= depth) {
-                //printd(5, "xml_stack::checkDepth(%d): deleting: %p (%d), new tail: %p\n", depth, tail, tail->depth, tail->next);
-                xml_node* n = tail->next;
-                delete tail;
-                tail = n;
-            }
+            stack.checkDepth(depth);
         }
 
         DLLLOCAL void push(QoreValue& node, int depth) {
-            xml_node* sn = new xml_node(node, depth);
-            sn->next = tail;
-            tail = sn;
+            stack.push(node, depth);
         }
         DLLLOCAL QoreValue getValue() {
-            return tail->node;
+            return *stack.top().node;
+        }
+        //! returns the next duplicate key suffix for the given element name in the current hash
+        DLLLOCAL int nextSuffix(const char* name) {
+            return stack.nextSuffix(name);
         }
         DLLLOCAL void setNode(QoreValue n) {
-            tail->node = n;
+            *stack.top().node = n;
         }
         DLLLOCAL QoreValue takeValue() {
             QoreValue rv = val;
@@ -125,22 +103,22 @@ namespace intern { // make classes local
             return rv;
         }
         DLLLOCAL int getValueCount() const {
-            return tail->vcount;
+            return stack.top().vcount;
         }
         DLLLOCAL void incValueCount() {
-            tail->vcount++;
+            stack.top().vcount++;
         }
         DLLLOCAL int getCDataCount() const {
-            return tail->cdcount;
+            return stack.top().cdcount;
         }
         DLLLOCAL void incCDataCount() {
-            tail->cdcount++;
+            stack.top().cdcount++;
         }
         DLLLOCAL int getCommentCount() const {
-            return tail->commentcount;
+            return stack.top().commentcount;
         }
         DLLLOCAL void incCommentCount() {
-            tail->commentcount++;
+            stack.top().commentcount++;
         }
     };
 }
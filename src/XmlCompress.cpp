@@ -0,0 +1,193 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlCompress.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlCompress.h"
+
+#include <string.h>
+
+CompressXmlSink::~CompressXmlSink() {
+    if (method == XCM_ZLIB)
+        deflateEnd(&zs);
+#ifdef HAVE_ZSTD
+    if (zcs)
+        ZSTD_freeCStream(zcs);
+#endif
+}
+
+bool CompressXmlSink::isMethod(const std::string& method) {
+    return method == "gzip" || method == "zlib" || method == "deflate" || method == "zstd";
+}
+
+bool CompressXmlSink::isLevel(const std::string& method, int64 level) {
+    if (level == -1)
+        return true;
+    if (method == "zstd") {
+#ifdef HAVE_ZSTD
+        return level >= 1 && level <= ZSTD_maxCLevel();
+#else
+        return level >= 1 && level <= 22;
+#endif
+    }
+    return level >= 0 && level <= 9;
+}
+
+int CompressXmlSink::init(ExceptionSink* xsink, const std::string& m, int64 level) {
+    assert(method == XCM_NONE);
+    if (m == "zstd") {
+#ifdef HAVE_ZSTD
+        zcs = ZSTD_createCStream();
+        if (!zcs) {
+            xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "failed to create the zstd compression context");
+            return -1;
+        }
+        if (!isLevel(m, level)) {
+            xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "invalid zstd compression level " QLLD "; expecting "
+                "-1 (default) or 1 - %d", level, ZSTD_maxCLevel());
+            return -1;
+        }
+        size_t rc = ZSTD_initCStream(zcs, level < 0 ? ZSTD_CLEVEL_DEFAULT : (int)level);
+        if (ZSTD_isError(rc)) {
+            xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "failed to initialize zstd compression with level "
+                QLLD ": %s", level, ZSTD_getErrorName(rc));
+            return -1;
+        }
+        method = XCM_ZSTD;
+        return 0;
+#else
+        xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "zstd compression is not supported by this build of the "
+            "xml module");
+        return -1;
+#endif
+    }
+
+    // window bits: 15 + 16 = gzip header, 15 = zlib header, -15 = raw deflate
+    int wbits;
+    if (m == "gzip")
+        wbits = 15 + 16;
+    else if (m == "zlib")
+        wbits = 15;
+    else if (m == "deflate")
+        wbits = -15;
+    else {
+        xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "unknown compression method '%s'; expecting one of "
+            "'gzip', 'zlib', 'deflate' or 'zstd'", m.c_str());
+        return -1;
+    }
+
+    if (!isLevel(m, level)) {
+        xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "invalid %s compression level " QLLD "; expecting -1 "
+            "(default) or 0 - 9", m.c_str(), level);
+        return -1;
+    }
+
+    memset(&zs, 0, sizeof zs);
+    int rc = deflateInit2(&zs, (int)level, Z_DEFLATED, wbits, 8, Z_DEFAULT_STRATEGY);
+    if (rc != Z_OK) {
+        xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "failed to initialize %s compression: %s", m.c_str(),
+            zs.msg ? zs.msg : zError(rc));
+        return -1;
+    }
+    method = XCM_ZLIB;
+    return 0;
+}
+
+int CompressXmlSink::write(const char* data, size_t len, ExceptionSink* xsink) {
+    switch (method) {
+        case XCM_ZLIB:
+            return zlibCompress(data, len, Z_NO_FLUSH, xsink);
+#ifdef HAVE_ZSTD
+        case XCM_ZSTD:
+            return zstdCompress(data, len, ZSTD_e_continue, xsink);
+#endif
+        default:
+            assert(false);
+            return -1;
+    }
+}
+
+int CompressXmlSink::finish(ExceptionSink* xsink) {
+    int rc;
+    switch (method) {
+        case XCM_ZLIB:
+            rc = zlibCompress(nullptr, 0, Z_FINISH, xsink);
+            break;
+#ifdef HAVE_ZSTD
+        case XCM_ZSTD:
+            rc = zstdCompress(nullptr, 0, ZSTD_e_end, xsink);
+            break;
+#endif
+        default:
+            assert(false);
+            return -1;
+    }
+    return rc ? rc : out.finish(xsink);
+}
+
+int CompressXmlSink::zlibCompress(const char* data, size_t len, int flush, ExceptionSink* xsink) {
+    zs.next_in = (Bytef*)data;
+    // zlib sizes are 32-bit; a flushed block is normally much smaller
+    while (true) {
+        uInt chunk = len > 0x40000000 ? 0x40000000 : (uInt)len;
+        zs.avail_in = chunk;
+        len -= chunk;
+        int zflush = len ? Z_NO_FLUSH : flush;
+        int rc;
+        do {
+            zs.next_out = (Bytef*)&obuf[0];
+            zs.avail_out = (uInt)obuf.size();
+            rc = deflate(&zs, zflush);
+            if (rc == Z_STREAM_ERROR) {
+                xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "compression failed: %s",
+                    zs.msg ? zs.msg : zError(rc));
+                return -1;
+            }
+            size_t n = obuf.size() - zs.avail_out;
+            if (n && out.write(&obuf[0], n, xsink))
+                return -1;
+        } while (!zs.avail_out && rc != Z_STREAM_END);
+        if (!len)
+            break;
+    }
+    return 0;
+}
+
+#ifdef HAVE_ZSTD
+int CompressXmlSink::zstdCompress(const char* data, size_t len, ZSTD_EndDirective end, ExceptionSink* xsink) {
+    ZSTD_inBuffer in = {data, len, 0};
+    while (true) {
+        ZSTD_outBuffer ob = {&obuf[0], obuf.size(), 0};
+        size_t rc = ZSTD_compressStream2(zcs, &ob, &in, end);
+        if (ZSTD_isError(rc)) {
+            xsink->raiseException("MAKE-XML-COMPRESSION-ERROR", "zstd compression failed: %s",
+                ZSTD_getErrorName(rc));
+            return -1;
+        }
+        if (ob.pos && out.write(&obuf[0], ob.pos, xsink))
+            return -1;
+        // with ZSTD_e_end, rc is the amount of data still to be flushed
+        if (end == ZSTD_e_end ? !rc : in.pos == in.size)
+            break;
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,112 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlCompress.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_XML_COMPRESS_H
+#define _QORE_XML_COMPRESS_H
+
+#include "qore-xml-module.h"
+#include "MakeXmlOutput.h"
+
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <string>
+#include <vector>
+
+// size of the buffer for compressed output
+#define XML_COMPRESS_BUFFER_SIZE (64 * 1024)
+
+/**
+ * Compresses serialized XML data and writes the compressed data to another sink.
+ *
+ * Supported methods are "gzip", "zlib", "deflate" (raw, without a header) and
+ * "zstd" if the module was built with libzstd.
+ */
+class CompressXmlSink : public AbstractXmlOutputSink {
+public:
+    DLLLOCAL CompressXmlSink(AbstractXmlOutputSink& out) : out(out), obuf(XML_COMPRESS_BUFFER_SIZE) {
+    }
+
+    DLLLOCAL virtual ~CompressXmlSink();
+
+    /**
+     * Initializes the compressor.
+     * @param method the compression method
+     * @param level the compression level; -1 = the default level for the method
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int init(ExceptionSink* xsink, const std::string& method, int64 level);
+
+    DLLLOCAL virtual int write(const char* data, size_t len, ExceptionSink* xsink);
+
+    //! Writes the end of the compressed stream and finishes the output sink
+    DLLLOCAL virtual int finish(ExceptionSink* xsink);
+
+    //! Returns true if the method is a supported compression method name; zstd is accepted even if not available
+    DLLLOCAL static bool isMethod(const std::string& method);
+
+    //! Returns true if the level is -1 (the default level) or a valid compression level for the method
+    DLLLOCAL static bool isLevel(const std::string& method, int64 level);
+
+private:
+    enum CompressMethod {
+        XCM_NONE,
+        XCM_ZLIB,   //!< gzip, zlib and deflate
+        XCM_ZSTD,
+    };
+
+    AbstractXmlOutputSink& out;
+    CompressMethod method = XCM_NONE;
+    z_stream zs;
+#ifdef HAVE_ZSTD
+    ZSTD_CStream* zcs = nullptr;
+#endif
+    std::vector<char> obuf;
+
+    DLLLOCAL int zlibCompress(const char* data, size_t len, int flush, ExceptionSink* xsink);
+#ifdef HAVE_ZSTD
+    DLLLOCAL int zstdCompress(const char* data, size_t len, ZSTD_EndDirective end, ExceptionSink* xsink);
+#endif
+};
+
+/**
+ * Appends serialized XML data to a binary object.
+ */
+class BinaryXmlSink : public AbstractXmlOutputSink {
+public:
+    DLLLOCAL BinaryXmlSink(BinaryNode& b) : b(b) {
+    }
+
+    DLLLOCAL virtual int write(const char* data, size_t len, ExceptionSink* xsink) {
+        b.append(data, len);
+        return 0;
+    }
+
+private:
+    BinaryNode& b;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlElementStack.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_XML_ELEMENT_STACK_H
+#define _QORE_XML_ELEMENT_STACK_H
+
+// this file does not depend on the Qore library so that the stack can be benchmarked standalone
+#include <stddef.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#ifndef DLLLOCAL
+#define DLLLOCAL
+#endif
+
+// entries are only kept for reuse by the next parse on the same thread up to this capacity
+#define XML_ELEMENT_STACK_MAX_SPARE 4096
+
+//! an open element while parsing XML into a data structure
+template <typename V>
+struct XmlElementStackEntry {
+    //! the value slot for the element
+    V* node;
+    int depth;
+    //! the number of text, CDATA and comment nodes seen in the element
+    int vcount;
+    int cdcount;
+    int commentcount;
+    //! the index of the first duplicate key suffix counter of the element
+    size_t sfirst;
+};
+
+//! the next duplicate key suffix for a child element name
+struct XmlElementSuffix {
+    const char* name;
+    int next;
+};
+
+//! a depth-indexed stack of the open elements while parsing XML
+/** Entries are stored in a contiguous vector, so pushing and popping elements does not allocate memory once the
+    vector has grown to the depth of the document.  The vector is kept when the stack is destroyed and reused by the
+    next stack created on the same thread; nested parses on the same thread allocate their own vector.
+
+    The duplicate key suffix counters of all open elements are stored in a second vector; the counters of an element
+    follow those of its parent, so they are discarded with the element.
+*/
+template <typename V>
+class XmlElementStack {
+public:
+    typedef XmlElementStackEntry<V> Entry;
+
+    DLLLOCAL XmlElementStack() : store(acquire()) {
+    }
+
+    DLLLOCAL ~XmlElementStack() {
+        store->entries.clear();
+        store->suffixes.clear();
+        if (!spare && store->entries.capacity() <= XML_ELEMENT_STACK_MAX_SPARE
+            && store->suffixes.capacity() <= XML_ELEMENT_STACK_MAX_SPARE)
+            spare.reset(store);
+        else
+            delete store;
+    }
+
+    XmlElementStack(const XmlElementStack&) = delete;
+    XmlElementStack& operator=(const XmlElementStack&) = delete;
+
+    DLLLOCAL void push(V& node, int depth) {
+        store->entries.push_back(Entry{&node, depth, 0, 0, 0, store->suffixes.size()});
+    }
+
+    //! removes all elements at the given depth or deeper; depth 0 is ignored
+    DLLLOCAL void checkDepth(int depth) {
+        if (!depth)
+            return;
+        entry_vec_t& entries = store->entries;
+        if (entries.empty() || entries.back().depth < depth)
+            return;
+        size_t sfirst;
+        do {
+            sfirst = entries.back().sfirst;
+            entries.pop_back();
+        } while (!entries.empty() && entries.back().depth >= depth);
+        store->suffixes.resize(sfirst);
+    }
+
+    //! returns the next duplicate key suffix for the given child element name of the top element
+    /** Suffixes for each name start at 1 and are assigned in order.  Names are compared by address first, so
+        passing names interned by the parser makes the lookup cheap; the name must remain valid while the top
+        element is on the stack.
+    */
+    DLLLOCAL int nextSuffix(const char* name) {
+        suffix_vec_t& suffixes = store->suffixes;
+        for (size_t i = store->entries.back().sfirst, e = suffixes.size(); i < e; ++i) {
+            XmlElementSuffix& s = suffixes[i];
+            if (s.name == name || !strcmp(s.name, name))
+                return s.next++;
+        }
+        suffixes.push_back(XmlElementSuffix{name, 2});
+        return 1;
+    }
+
+    DLLLOCAL bool empty() const {
+        return store->entries.empty();
+    }
+
+    DLLLOCAL Entry& top() {
+        return store->entries.back();
+    }
+
+    DLLLOCAL const Entry& top() const {
+        return store->entries.back();
+    }
+
+private:
+    typedef std::vector<Entry> entry_vec_t;
+    typedef std::vector<XmlElementSuffix> suffix_vec_t;
+
+    struct Store {
+        entry_vec_t entries;
+        suffix_vec_t suffixes;
+    };
+
+    Store* store;
+
+    //! storage released by the last stack on this thread
+    static thread_local std::unique_ptr<Store> spare;
+
+    DLLLOCAL static Store* acquire() {
+        if (spare)
+            return spare.release();
+        Store* rv = new Store;
+        rv->entries.reserve(64);
+        return rv;
+    }
+};
+
+template <typename V>
+thread_local std::unique_ptr<typename XmlElementStack<V>::Store> XmlElementStack<V>::spare;
+
+#endif
@@ -0,0 +1,162 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlEscape.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlEscape.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QORE_XML_ESCAPE_SSE2 1
+#endif
+
+// AVX2 is selected at runtime, so it can only be used with compilers supporting per-function target attributes
+#if defined(QORE_XML_ESCAPE_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define QORE_XML_ESCAPE_AVX2 1
+#endif
+
+// byte classes: 1 = XML special character, 2 = non-ASCII byte
+#define XEC_NONE 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+#define XEC_HIGH 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2
+static const unsigned char xml_escape_class[256] = {
+    XEC_NONE, XEC_NONE,
+    // 0x20: '"' (0x22), '&' (0x26), '\'' (0x27)
+    0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+    // 0x30: '<' (0x3c), '>' (0x3e)
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0,
+    XEC_NONE, XEC_NONE, XEC_NONE, XEC_NONE,
+    XEC_HIGH, XEC_HIGH, XEC_HIGH, XEC_HIGH, XEC_HIGH, XEC_HIGH, XEC_HIGH, XEC_HIGH,
+};
+
+static size_t xml_escape_scan_scalar(const char* p, size_t len, bool nonascii) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+    unsigned char mask = nonascii ? 3 : 1;
+    for (size_t i = 0; i < len; ++i) {
+        if (xml_escape_class[s[i]] & mask)
+            return i;
+    }
+    return len;
+}
+
+#ifdef QORE_XML_ESCAPE_SSE2
+static inline unsigned xml_escape_ctz(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    unsigned rv = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++rv;
+    }
+    return rv;
+#endif
+}
+
+/* the special characters are matched with three comparisons per block:
+   - '"' (0x22)
+   - '&' (0x26) and '\'' (0x27) as (c | 0x01) == 0x27
+   - '<' (0x3c) and '>' (0x3e) as (c | 0x02) == 0x3e
+   non-ASCII bytes are those with the sign bit set
+*/
+static size_t xml_escape_scan_sse2(const char* p, size_t len, bool nonascii) {
+    const __m128i quot = _mm_set1_epi8(0x22);
+    const __m128i amp_apos = _mm_set1_epi8(0x27);
+    const __m128i lt_gt = _mm_set1_epi8(0x3e);
+    const __m128i bit0 = _mm_set1_epi8(0x01);
+    const __m128i bit1 = _mm_set1_epi8(0x02);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, quot),
+            _mm_or_si128(_mm_cmpeq_epi8(_mm_or_si128(v, bit0), amp_apos),
+                _mm_cmpeq_epi8(_mm_or_si128(v, bit1), lt_gt)));
+        unsigned mask = _mm_movemask_epi8(m);
+        if (nonascii)
+            mask |= _mm_movemask_epi8(v);
+        if (mask)
+            return i + xml_escape_ctz(mask);
+    }
+    return i + xml_escape_scan_scalar(p + i, len - i, nonascii);
+}
+#endif
+
+#ifdef QORE_XML_ESCAPE_AVX2
+__attribute__((target("avx2")))
+static size_t xml_escape_scan_avx2(const char* p, size_t len, bool nonascii) {
+    const __m256i quot = _mm256_set1_epi8(0x22);
+    const __m256i amp_apos = _mm256_set1_epi8(0x27);
+    const __m256i lt_gt = _mm256_set1_epi8(0x3e);
+    const __m256i bit0 = _mm256_set1_epi8(0x01);
+    const __m256i bit1 = _mm256_set1_epi8(0x02);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, quot),
+            _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_or_si256(v, bit0), amp_apos),
+                _mm256_cmpeq_epi8(_mm256_or_si256(v, bit1), lt_gt)));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (nonascii)
+            mask |= static_cast<unsigned>(_mm256_movemask_epi8(v));
+        if (mask)
+            return i + xml_escape_ctz(mask);
+    }
+    // process the remainder with the SSE2 kernel
+    return i + xml_escape_scan_sse2(p + i, len - i, nonascii);
+}
+#endif
+
+typedef size_t (*q_xml_escape_scan_t)(const char* p, size_t len, bool nonascii);
+
+struct XmlEscapeKernel {
+    q_xml_escape_scan_t scan;
+    const char* name;
+
+    DLLLOCAL XmlEscapeKernel() {
+#ifdef QORE_XML_ESCAPE_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            scan = xml_escape_scan_avx2;
+            name = "avx2";
+            return;
+        }
+#endif
+#ifdef QORE_XML_ESCAPE_SSE2
+        scan = xml_escape_scan_sse2;
+        name = "sse2";
+#else
+        scan = xml_escape_scan_scalar;
+        name = "scalar";
+#endif
+    }
+};
+
+static XmlEscapeKernel xml_escape_kernel;
+
+size_t xml_escape_scan(const char* p, size_t len, bool nonascii) {
+    return xml_escape_kernel.scan(p, len, nonascii);
+}
+
+const char* xml_escape_scan_kernel() {
+    return xml_escape_kernel.name;
+}
@@ -0,0 +1,115 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlEscape.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_XML_ESCAPE_H
+#define _QORE_XML_ESCAPE_H
+
+// this file does not depend on the Qore library so that the scanning kernel can be benchmarked standalone
+#include <stddef.h>
+#include <string.h>
+
+#ifndef DLLLOCAL
+#define DLLLOCAL
+#endif
+
+//! returns the length of the initial run of bytes that can be copied to XML text or attribute values unescaped
+/** The scan stops at the first '<', '>', '&', '"' or '\'' character, and at the first non-ASCII byte if
+    \a nonascii is true.  Uses AVX2 or SSE2 where available and a scalar loop otherwise.
+*/
+DLLLOCAL size_t xml_escape_scan(const char* p, size_t len, bool nonascii);
+
+//! returns the name of the scanning kernel in use (\c "avx2", \c "sse2" or \c "scalar")
+DLLLOCAL const char* xml_escape_scan_kernel();
+
+//! returns the XML entity for an ASCII special character or nullptr if the character needs no escaping
+DLLLOCAL static inline const char* xml_escape_get_entity(unsigned char c, size_t& len) {
+    switch (c) {
+        case '&': len = 5; return "&amp;";
+        case '<': len = 4; return "&lt;";
+        case '>': len = 4; return "&gt;";
+        case '"': len = 6; return "&quot;";
+        case '\'': len = 6; return "&apos;";
+    }
+    return nullptr;
+}
+
+//! decodes the UTF-8 character at \a p and returns the number of bytes used, or 0 if the sequence is invalid
+DLLLOCAL static inline size_t xml_escape_decode_utf8(const unsigned char* p, size_t len, unsigned& cp) {
+    unsigned char c = p[0];
+    size_t n;
+    if (c >= 0xc2 && c <= 0xdf) {
+        n = 2;
+        cp = c & 0x1f;
+    } else if (c >= 0xe0 && c <= 0xef) {
+        n = 3;
+        cp = c & 0x0f;
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        n = 4;
+        cp = c & 0x07;
+    } else {
+        return 0;
+    }
+    if (len < n)
+        return 0;
+    for (size_t i = 1; i < n; ++i) {
+        if ((p[i] & 0xc0) != 0x80)
+            return 0;
+        cp = (cp << 6) | (p[i] & 0x3f);
+    }
+    return n;
+}
+
+//! the minimum buffer size for xml_escape_format_char_ref()
+#define XML_ESCAPE_CHAR_REF_SIZE 13
+
+//! writes the decimal character reference for the code point (like "&#%u;") and returns the number of bytes
+//! written; the output is not terminated
+DLLLOCAL static inline size_t xml_escape_format_char_ref(char* buf, unsigned cp) {
+    // the digits are written from the end of a temporary buffer
+    char tmp[10];
+    char* e = tmp + sizeof tmp;
+    char* p = e;
+    do {
+        *--p = (char)('0' + cp % 10);
+        cp /= 10;
+    } while (cp);
+    size_t n = e - p;
+    buf[0] = '&';
+    buf[1] = '#';
+    memcpy(buf + 2, p, n);
+    buf[n + 2] = ';';
+    return n + 3;
+}
+
+//! returns true if the code point can start an XML name other than a qualified name (XML 1.0 NameStartChar
+//! without ':')
+DLLLOCAL static inline bool xml_is_name_start_char(unsigned cp) {
+    if (cp < 0x80)
+        return (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z') || cp == '_';
+    return (cp >= 0xc0 && cp <= 0xd6) || (cp >= 0xd8 && cp <= 0xf6) || (cp >= 0xf8 && cp <= 0x2ff)
+        || (cp >= 0x370 && cp <= 0x37d) || (cp >= 0x37f && cp <= 0x1fff) || (cp >= 0x200c && cp <= 0x200d)
+        || (cp >= 0x2070 && cp <= 0x218f) || (cp >= 0x2c00 && cp <= 0x2fef) || (cp >= 0x3001 && cp <= 0xd7ff)
+        || (cp >= 0xf900 && cp <= 0xfdcf) || (cp >= 0xfdf0 && cp <= 0xfffd) || (cp >= 0x10000 && cp <= 0xeffff);
+}
+
+#endif
@@ -0,0 +1,103 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlMappedFile.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlMappedFile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if (defined _WIN32 || defined __WIN32__) && ! defined __CYGWIN__
+#include <io.h>
+#else
+#include <sys/mman.h>
+#define QORE_XML_HAVE_MMAP 1
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+XmlMappedFile::~XmlMappedFile() {
+#ifdef QORE_XML_HAVE_MMAP
+    if (mapped)
+        munmap(const_cast<char*>(buf), len);
+#endif
+}
+
+int XmlMappedFile::open(ExceptionSink* xsink, const char* fn, const char* err) {
+    assert(!mapped && data.empty());
+    int fd = ::open(fn, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        xsink->raiseErrnoException(err, errno, "could not open '%s' for reading", fn);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        xsink->raiseErrnoException(err, errno, "could not stat '%s'", fn);
+        close(fd);
+        return -1;
+    }
+
+#ifdef QORE_XML_HAVE_MMAP
+    // empty files cannot be mapped
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            close(fd);
+#ifdef MADV_SEQUENTIAL
+            madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+            buf = static_cast<const char*>(p);
+            len = (size_t)st.st_size;
+            mapped = true;
+            return 0;
+        }
+        // read the file if it cannot be mapped
+    }
+#endif
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+        data.reserve((size_t)st.st_size);
+    char rbuf[64 * 1024];
+    while (true) {
+        ssize_t rc = ::read(fd, rbuf, sizeof rbuf);
+        if (!rc)
+            break;
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            xsink->raiseErrnoException(err, errno, "error reading '%s'", fn);
+            close(fd);
+            return -1;
+        }
+        data.append(rbuf, rc);
+    }
+    close(fd);
+    buf = data.data();
+    len = data.size();
+    return 0;
+}
@@ -0,0 +1,78 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlMappedFile.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_XML_MAPPED_FILE_H
+#define _QORE_XML_MAPPED_FILE_H
+
+#include "qore-xml-module.h"
+
+#include <string>
+
+/**
+ * Provides the contents of a file in memory for parsing.
+ *
+ * Regular files are mapped read-only with mmap(); the mapping is advised for sequential access, so pages are read
+ * ahead while the parser works through them and no copy of the file is made.  Other files (such as pipes) and files
+ * on platforms without mmap() are read into a buffer.
+ */
+class XmlMappedFile {
+public:
+    DLLLOCAL XmlMappedFile() {
+    }
+
+    DLLLOCAL ~XmlMappedFile();
+
+    /**
+     * Maps or reads the file.
+     * @param err the exception code for errors opening or reading the file
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int open(ExceptionSink* xsink, const char* fn, const char* err);
+
+    //! returns the contents of the file; not terminated
+    DLLLOCAL const char* getBuffer() const {
+        return buf;
+    }
+
+    //! returns the size of the file in bytes
+    DLLLOCAL size_t size() const {
+        return len;
+    }
+
+    //! returns true if the file is mapped
+    DLLLOCAL bool isMapped() const {
+        return mapped;
+    }
+
+private:
+    const char* buf = "";
+    size_t len = 0;
+    bool mapped = false;
+    //! the contents of files that cannot be mapped
+    std::string data;
+
+    DLLLOCAL XmlMappedFile(const XmlMappedFile&) = delete;
+    DLLLOCAL XmlMappedFile& operator=(const XmlMappedFile&) = delete;
+};
+
+#endif
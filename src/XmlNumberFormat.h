@@ -0,0 +1,380 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlNumberFormat.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_XML_NUMBER_FORMAT_H
+#define _QORE_XML_NUMBER_FORMAT_H
+
+// number formatting for the XML serializers; like XmlEscape.h, this file does not depend on the Qore library
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef DLLLOCAL
+#define DLLLOCAL
+#endif
+
+//! the minimum buffer size for xml_format_int()
+#define XML_FORMAT_INT_SIZE 20
+//! the minimum buffer size for xml_format_double()
+#define XML_FORMAT_DOUBLE_SIZE 32
+
+//! formats an integer like printf("%lld") and returns the number of bytes written; the output is not terminated
+DLLLOCAL static inline size_t xml_format_int(char* buf, int64_t v) {
+    static const char digit_pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    // the digits are written from the end of a temporary buffer
+    char tmp[XML_FORMAT_INT_SIZE];
+    char* e = tmp + sizeof tmp;
+    char* p = e;
+    uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    while (u >= 100) {
+        unsigned i = (unsigned)(u % 100) * 2;
+        u /= 100;
+        p -= 2;
+        memcpy(p, digit_pairs + i, 2);
+    }
+    if (u >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + u * 2, 2);
+    } else {
+        *--p = (char)('0' + u);
+    }
+    if (v < 0)
+        *--p = '-';
+
+    size_t len = e - p;
+    memcpy(buf, p, len);
+    return len;
+}
+
+//! a non-negative integer with enough bits for the exact decimal conversion of a double
+class XmlFormatBigInt {
+public:
+    DLLLOCAL explicit XmlFormatBigInt(uint64_t v = 0) {
+        w[0] = (uint32_t)v;
+        w[1] = (uint32_t)(v >> 32);
+        n = w[1] ? 2 : (w[0] ? 1 : 0);
+    }
+
+    //! multiplies the number by \a m
+    DLLLOCAL void mul(uint32_t m) {
+        uint64_t carry = 0;
+        for (unsigned i = 0; i < n; ++i) {
+            uint64_t t = (uint64_t)w[i] * m + carry;
+            w[i] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        if (carry)
+            w[n++] = (uint32_t)carry;
+    }
+
+    //! multiplies the number by 10^\a e
+    DLLLOCAL void mulPow10(int e) {
+        for (; e >= 9; e -= 9)
+            mul(1000000000);
+        static const uint32_t pow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+        if (e)
+            mul(pow10[e]);
+    }
+
+    //! multiplies the number by 2^\a e
+    DLLLOCAL void shl(int e) {
+        if (!n)
+            return;
+        unsigned words = e / 32, bits = e % 32;
+        if (bits) {
+            uint32_t carry = 0;
+            for (unsigned i = 0; i < n; ++i) {
+                uint32_t t = w[i];
+                w[i] = (t << bits) | carry;
+                carry = t >> (32 - bits);
+            }
+            if (carry)
+                w[n++] = carry;
+        }
+        if (words) {
+            memmove(w + words, w, n * sizeof(uint32_t));
+            memset(w, 0, words * sizeof(uint32_t));
+            n += words;
+        }
+    }
+
+    //! returns <0, 0 or >0 if the number is less than, equal to or greater than \a b
+    DLLLOCAL int cmp(const XmlFormatBigInt& b) const {
+        if (n != b.n)
+            return n < b.n ? -1 : 1;
+        for (unsigned i = n; i > 0; --i) {
+            if (w[i - 1] != b.w[i - 1])
+                return w[i - 1] < b.w[i - 1] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    //! subtracts \a b, which must not be greater than the number
+    DLLLOCAL void sub(const XmlFormatBigInt& b) {
+        int64_t borrow = 0;
+        for (unsigned i = 0; i < n; ++i) {
+            int64_t t = (int64_t)w[i] - (i < b.n ? b.w[i] : 0) - borrow;
+            borrow = t < 0;
+            w[i] = (uint32_t)t;
+        }
+        while (n && !w[n - 1])
+            --n;
+    }
+
+    //! divides the number by \a b and returns the quotient, which must be less than 10; the number is set to the
+    //! remainder
+    DLLLOCAL unsigned divSmall(const XmlFormatBigInt& b) {
+        unsigned q = 0;
+        while (cmp(b) >= 0) {
+            sub(b);
+            ++q;
+        }
+        return q;
+    }
+
+private:
+    //! 2^1074 * 10^(17 + 20) needs less than 1200 bits
+    uint32_t w[40];
+    //! the number of words used
+    unsigned n;
+};
+
+//! rounds the digits up by one unit in the last place; returns true if the digits overflowed to "1000..."
+DLLLOCAL static inline bool xml_format_round_up(char* digits, int precision) {
+    int i = precision - 1;
+    while (i >= 0 && digits[i] == '9')
+        digits[i--] = '0';
+    if (i >= 0) {
+        ++digits[i];
+        return false;
+    }
+    digits[0] = '1';
+    return true;
+}
+
+//! writes the first \a precision significant digits of m * 2^e rounded half to even and sets \a k to the decimal
+//! exponent of the first digit
+/** uses arbitrary precision integers, so it works for all finite doubles
+*/
+DLLLOCAL static inline void xml_format_double_digits(char* digits, uint64_t m, int e, int bitlen, int precision,
+        int& k) {
+    // m * 2^e = r / s * 10^k with 1 <= r / s < 10
+    XmlFormatBigInt r(m), s(1);
+    if (e >= 0)
+        r.shl(e);
+    else
+        s.shl(-e);
+    // log10(2) ~= 0.30103; the estimate is corrected below
+    k = (int)((e + bitlen - 1) * 0.30102999566398120);
+    if (e + bitlen - 1 < 0)
+        --k;
+    if (k >= 0)
+        s.mulPow10(k);
+    else
+        r.mulPow10(-k);
+    XmlFormatBigInt s10(s);
+    s10.mul(10);
+    while (r.cmp(s10) >= 0) {
+        s.mul(10);
+        s10.mul(10);
+        ++k;
+    }
+    while (r.cmp(s) < 0) {
+        r.mul(10);
+        --k;
+    }
+
+    for (int i = 0; i < precision; ++i) {
+        if (i)
+            r.mul(10);
+        digits[i] = (char)('0' + r.divSmall(s));
+    }
+    // round half to even with the remainder
+    r.mul(2);
+    int c = r.cmp(s);
+    if ((c > 0 || (!c && ((digits[precision - 1] - '0') & 1))) && xml_format_round_up(digits, precision))
+        ++k;
+}
+
+#ifdef __SIZEOF_INT128__
+//! like xml_format_double_digits() but with 128-bit integers for the common case of moderate exponents
+/** @return true if the digits were written, false if the numbers do not fit into 128 bits
+*/
+DLLLOCAL static inline bool xml_format_double_digits128(char* digits, uint64_t m, int e, int bitlen, int precision,
+        int& k) {
+    typedef unsigned __int128 u128;
+    // 10^0 - 10^38
+    static const struct Pow10 {
+        u128 v[39];
+        Pow10() {
+            v[0] = 1;
+            for (int i = 1; i < 39; ++i)
+                v[i] = v[i - 1] * 10;
+        }
+    } pow10;
+
+    // the estimate may be one too low; log2(10) < 3.33
+    k = (int)((e + bitlen - 1) * 0.30102999566398120);
+    if (e + bitlen - 1 < 0)
+        --k;
+    while (true) {
+        // m * 2^e * 10^t = num / den with a quotient of precision digits
+        int t = precision - 1 - k;
+        if (t > 38 || t < -38)
+            return false;
+        int num_bits = bitlen + (e > 0 ? e : 0) + (t > 0 ? t * 10 / 3 + 1 : 0);
+        int den_bits = (e < 0 ? -e : 0) + (t < 0 ? -t * 10 / 3 + 1 : 0) + 1;
+        if (num_bits > 127 || den_bits > 126)
+            return false;
+        u128 num = (u128)m << (e > 0 ? e : 0);
+        u128 den = (u128)1 << (e < 0 ? -e : 0);
+        if (t > 0)
+            num *= pow10.v[t];
+        else if (t < 0)
+            den *= pow10.v[-t];
+        u128 q = num / den;
+        if (q >= pow10.v[precision]) {
+            ++k;
+            continue;
+        }
+        if (q < pow10.v[precision - 1]) {
+            --k;
+            continue;
+        }
+        // round half to even with the remainder
+        u128 rem2 = (num - q * den) * 2;
+        if (rem2 > den || (rem2 == den && (q & 1))) {
+            if (++q == pow10.v[precision]) {
+                q = pow10.v[precision - 1];
+                ++k;
+            }
+        }
+        for (int i = precision - 1; i >= 0; --i) {
+            digits[i] = (char)('0' + (unsigned)(q % 10));
+            q /= 10;
+        }
+        return true;
+    }
+}
+#endif
+
+//! formats a double like printf("%.<precision>g") in the "C" locale and returns the number of bytes written; the
+//! output is not terminated
+/** The first \a precision significant digits of the exact value are generated with integer arithmetic and rounded
+    half to even like glibc; \a precision must not be greater than 20.
+*/
+DLLLOCAL static inline size_t xml_format_double(char* buf, double v, int precision) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof bits);
+    char* p = buf;
+    if (bits >> 63)
+        *p++ = '-';
+    int be = (int)((bits >> 52) & 0x7ff);
+    uint64_t m = bits & ((1ull << 52) - 1);
+    if (be == 0x7ff) {
+        memcpy(p, m ? "nan" : "inf", 3);
+        return p + 3 - buf;
+    }
+    if (!be && !m) {
+        *p = '0';
+        return p + 1 - buf;
+    }
+    int e, bitlen;
+    if (be) {
+        m |= 1ull << 52;
+        e = be - 1075;
+        bitlen = 53;
+    } else {
+        // subnormal
+        e = -1074;
+        for (bitlen = 0; m >> bitlen; ++bitlen) {
+        }
+    }
+    if (precision < 1)
+        precision = 1;
+
+    char digits[20];
+    int k;
+#ifdef __SIZEOF_INT128__
+    if (!xml_format_double_digits128(digits, m, e, bitlen, precision, k))
+#endif
+        xml_format_double_digits(digits, m, e, bitlen, precision, k);
+
+    // trailing zeros are not output
+    int nd = precision;
+    while (nd > 1 && digits[nd - 1] == '0')
+        --nd;
+
+    if (k < -4 || k >= precision) {
+        // d.ddde[+-]XX
+        *p++ = digits[0];
+        if (nd > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, nd - 1);
+            p += nd - 1;
+        }
+        *p++ = 'e';
+        if (k < 0) {
+            *p++ = '-';
+            k = -k;
+        } else {
+            *p++ = '+';
+        }
+        if (k >= 100) {
+            *p++ = (char)('0' + k / 100);
+            k %= 100;
+        }
+        *p++ = (char)('0' + k / 10);
+        *p++ = (char)('0' + k % 10);
+    } else if (k >= 0) {
+        // ddd.ddd
+        if (nd <= k) {
+            memcpy(p, digits, nd);
+            memset(p + nd, '0', k + 1 - nd);
+            p += k + 1;
+        } else {
+            memcpy(p, digits, k + 1);
+            p += k + 1;
+            if (nd > k + 1) {
+                *p++ = '.';
+                memcpy(p, digits + k + 1, nd - k - 1);
+                p += nd - k - 1;
+            }
+        }
+    } else {
+        // 0.000ddd
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -k - 1);
+        p += -k - 1;
+        memcpy(p, digits, nd);
+        p += nd;
+    }
+    return p - buf;
+}
+
+#endif
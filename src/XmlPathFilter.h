@@ -0,0 +1,163 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlPathFilter.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _QORE_XML_PATH_FILTER_H
+#define _QORE_XML_PATH_FILTER_H
+
+// this file does not depend on the Qore library
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#ifndef DLLLOCAL
+#define DLLLOCAL
+#endif
+
+//! the result of matching an element against the paths of an XmlPathFilter
+enum XmlPathMatch {
+    XPM_SKIP,     //!< the element and its subtree are not selected
+    XPM_ANCESTOR, //!< the element is on the path to selected elements
+    XPM_SELECT,   //!< the element and its subtree are selected
+};
+
+//! selects elements of a document with simple paths
+/** A path is a list of element names separated by \c '/' starting with the root element, for example
+    \c "Envelope/Body/getResponse/result"; a segment consisting of \c '*' matches any element.  Segments without a
+    namespace prefix match the local name of an element, segments with a prefix match the qualified name.
+
+    Elements are matched in document order; match() is called for the root element and for the children of elements
+    matched as XPM_ANCESTOR or XPM_SELECT.  Each path has an integer tag; getTag() returns the tag of the first path
+    added that selected the last element matched.
+*/
+class XmlPathFilter {
+public:
+    /** adds a path
+        @return 0 = OK, -1 = the path is empty or has an empty segment
+    */
+    DLLLOCAL int add(const char* path, int tag = 0) {
+        if (*path == '/')
+            ++path;
+        std::vector<std::string> segs;
+        while (true) {
+            const char* p = strchr(path, '/');
+            size_t len = p ? (size_t)(p - path) : strlen(path);
+            if (!len)
+                return -1;
+            segs.push_back(std::string(path, len));
+            if (!p)
+                break;
+            path = p + 1;
+        }
+        paths.push_back(std::move(segs));
+        tags.push_back(tag);
+        return 0;
+    }
+
+    DLLLOCAL bool empty() const {
+        return paths.empty();
+    }
+
+    //! resets the match state to parse another document
+    DLLLOCAL void reset() {
+        active.clear();
+        levels.clear();
+    }
+
+    //! matches an element with the given name at the given depth
+    DLLLOCAL XmlPathMatch match(const char* name, int depth) {
+        // discard the matches of elements that have been closed
+        if (levels.size() > (size_t)depth) {
+            active.resize(levels[depth]);
+            levels.resize(depth);
+        }
+        if (levels.size() != (size_t)depth) {
+            // the parent element was not matched as an ancestor
+            assert(false);
+            return XPM_SKIP;
+        }
+
+        size_t start = active.size();
+        bool select = false;
+        if (!depth) {
+            for (unsigned i = 0; i < paths.size(); ++i) {
+                if (matchName(paths[i][0], name)) {
+                    active.push_back(i);
+                    if (paths[i].size() == 1 && !select) {
+                        select = true;
+                        tag = tags[i];
+                    }
+                }
+            }
+        } else {
+            // matches are kept in the order the paths were added
+            for (size_t j = levels[depth - 1]; j < start; ++j) {
+                unsigned i = active[j];
+                if (paths[i].size() > (size_t)depth && matchName(paths[i][depth], name)) {
+                    active.push_back(i);
+                    if (paths[i].size() == (size_t)depth + 1 && !select) {
+                        select = true;
+                        tag = tags[i];
+                    }
+                }
+            }
+        }
+        levels.push_back(start);
+
+        if (select)
+            return XPM_SELECT;
+        return active.size() > start ? XPM_ANCESTOR : XPM_SKIP;
+    }
+
+    //! returns the tag of the path that selected the last element matched
+    DLLLOCAL int getTag() const {
+        return tag;
+    }
+
+private:
+    //! the paths split into segments
+    std::vector<std::vector<std::string>> paths;
+    //! the tag of each path
+    std::vector<int> tags;
+    //! the tag of the last selected element
+    int tag = 0;
+    //! the paths matching the open elements at each depth; the matches for depth d start at levels[d]
+    std::vector<unsigned> active;
+    std::vector<size_t> levels;
+
+    DLLLOCAL static bool matchName(const std::string& seg, const char* name) {
+        if (seg.size() == 1 && seg[0] == '*')
+            return true;
+        if (seg.find(':') == std::string::npos) {
+            const char* p = strchr(name, ':');
+            if (p)
+                name = p + 1;
+        }
+        return seg == name;
+    }
+};
+
+#endif
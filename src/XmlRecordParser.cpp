@@ -0,0 +1,237 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlRecordParser.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlRecordParser.h"
+#include "XmlSaxParser.h"
+
+#include <limits.h>
+
+XmlRecordParser::~XmlRecordParser() {
+    // discard errors in chunks parsed after the first error
+    for (auto& i : chunks) {
+        if (i)
+            i->xsink.clear();
+    }
+}
+
+QoreListNode* XmlRecordParser::parse(ExceptionSink* xsink) {
+    if (scanner.init()) {
+        xsink->raiseException("PARSE-XML-EXCEPTION", "no root element found in the XML document");
+        return nullptr;
+    }
+
+    ReferenceHolder<QoreListNode> rv(new QoreListNode(autoTypeInfo), xsink);
+    int rc;
+    if (threads > 1) {
+        rc = parseParallel(xsink, *rv);
+    } else {
+        rc = parseWhole(xsink, *rv);
+        if (rc > 0)
+            rc = parseSerial(xsink, *rv);
+    }
+    if (rc)
+        return nullptr;
+
+    if (scanner.truncated()) {
+        xsink->raiseException("PARSE-XML-EXCEPTION", "the root element '%s' is not closed in the XML document",
+            scanner.getRootName().c_str());
+        return nullptr;
+    }
+    return rv.release();
+}
+
+int XmlRecordParser::parseSerial(ExceptionSink* xsink, QoreListNode* l) {
+    Chunk c;
+    std::string doc;
+    XmlSaxParserContext ctxt;
+    while (scanner.next(c.records, XML_RECORD_CHUNK_SIZE)) {
+        parseChunk(c, dopts, doc, ctxt);
+        if (c.xsink) {
+            xsink->assimilate(c.xsink);
+            return -1;
+        }
+        if (addRecords(xsink, l, *c.h))
+            return -1;
+        c.h = nullptr;
+    }
+    return 0;
+}
+
+int XmlRecordParser::parseWhole(ExceptionSink* xsink, QoreListNode* l) {
+    // documents that are too large for libxml2 and a select option of the caller require chunks
+    if (len > INT_MAX || (dopts && !dopts->select.empty()))
+        return 1;
+
+    // the records are the children of the root element with the given name; as in the scanner, a name without a
+    // prefix matches the local name of the records, but a prefix cannot be matched when prefixes are stripped
+    if ((pflags & XPF_STRIP_NS_PREFIXES) && strchr(element, ':'))
+        return 1;
+    std::string path = "*/";
+    path += element;
+
+    XmlDataOpts opts(dopts ? *dopts : XmlDataOpts());
+    opts.select.add(path.c_str());
+
+    ReferenceHolder<QoreHashNode> h(QoreXmlDataBuilder::parse(xsink, buf, (int)len, encoding, options, nullptr,
+        data_ccsid, pflags, &opts), xsink);
+    if (!h) {
+        // report a root element that is not closed with the same error as when parsing in chunks
+        XmlRecordChunk c;
+        while (scanner.next(c, XML_RECORD_CHUNK_SIZE)) {
+        }
+        if (scanner.truncated()) {
+            xsink->clear();
+            xsink->raiseException("PARSE-XML-EXCEPTION", "the root element '%s' is not closed in the XML document",
+                scanner.getRootName().c_str());
+        }
+        return -1;
+    }
+    // the root element is closed, as the document was parsed without errors
+    return addRecords(xsink, l, *h);
+}
+
+int XmlRecordParser::parseParallel(ExceptionSink* xsink, QoreListNode* l) {
+    int rc = 0;
+    for (unsigned i = 0; i < threads; ++i) {
+        {
+            AutoLocker al(lck);
+            ++running;
+        }
+        if (q_start_thread(xsink, worker, this) == -1) {
+            AutoLocker al(lck);
+            --running;
+            rc = -1;
+            break;
+        }
+    }
+
+    for (size_t i = 0; !rc; ++i) {
+        Chunk* c;
+        {
+            AutoLocker al(lck);
+            while (i == chunks.size() ? !scan_done : !chunks[i]->done)
+                cond.wait(lck);
+            if (i == chunks.size())
+                break;
+            c = chunks[i].get();
+        }
+        if (c->xsink) {
+            xsink->assimilate(c->xsink);
+            rc = -1;
+            break;
+        }
+        if (addRecords(xsink, l, *c->h))
+            rc = -1;
+        // free the chunk
+        AutoLocker al(lck);
+        chunks[i].reset();
+        ++consumed;
+        cond.broadcast();
+    }
+
+    // stop the workers on errors and wait for them to exit
+    AutoLocker al(lck);
+    if (rc) {
+        stop = true;
+        cond.broadcast();
+    }
+    while (running)
+        cond.wait(lck);
+    return rc;
+}
+
+void XmlRecordParser::work() {
+    // each worker has its own copy of the options, which hold state while parsing
+    std::unique_ptr<XmlDataOpts> opts(dopts ? new XmlDataOpts(*dopts) : nullptr);
+    std::string doc;
+    XmlSaxParserContext ctxt;
+    while (true) {
+        Chunk* c;
+        {
+            AutoLocker al(lck);
+            while (!stop && !scan_done && chunks.size() >= consumed + threads * 2)
+                cond.wait(lck);
+            if (stop || scan_done)
+                break;
+            // records are found under the lock, which is fast compared to parsing them
+            std::unique_ptr<Chunk> nc(new Chunk);
+            if (!scanner.next(nc->records, XML_RECORD_CHUNK_SIZE)) {
+                scan_done = true;
+                cond.broadcast();
+                break;
+            }
+            c = nc.get();
+            chunks.push_back(std::move(nc));
+        }
+        parseChunk(*c, opts.get(), doc, ctxt);
+        AutoLocker al(lck);
+        c->done = true;
+        cond.broadcast();
+    }
+    AutoLocker al(lck);
+    --running;
+    cond.broadcast();
+}
+
+void XmlRecordParser::parseChunk(Chunk& c, XmlDataOpts* opts, std::string& doc, XmlSaxParserContext& ctxt) {
+    // the prolog and the start tag of the root element, the records and the end tag of the root element
+    doc.assign(buf, scanner.getRootEnd());
+    for (auto& i : c.records.ranges)
+        doc.append(buf + i.first, i.second - i.first);
+    doc.append("</");
+    doc.append(scanner.getRootName());
+    doc.append(">");
+
+    if (doc.size() > INT_MAX) {
+        c.xsink.raiseException("PARSE-XML-EXCEPTION", "XML record is too large to be parsed (%lld bytes)",
+            (long long)c.records.size);
+        return;
+    }
+    c.h = QoreXmlDataBuilder::parse(&c.xsink, doc.data(), (int)doc.size(), encoding, options, nullptr, data_ccsid,
+        pflags, opts, &ctxt);
+}
+
+int XmlRecordParser::addRecords(ExceptionSink* xsink, QoreListNode* l, const QoreHashNode* h) {
+    ConstHashIterator i(h);
+    if (!i.next() || i.get().getType() != NT_HASH)
+        return 0;
+
+    // the root element only has the records and any attributes; records in a chunk have the same name
+    ConstHashIterator ri(i.get().get<const QoreHashNode>());
+    while (ri.next()) {
+        if (!strcmp(ri.getKey(), "^attributes^"))
+            continue;
+        QoreValue v = ri.get();
+        if (v.getType() != NT_LIST) {
+            if (l->push(v.refSelf(), xsink))
+                return -1;
+            continue;
+        }
+        const QoreListNode* rl = v.get<const QoreListNode>();
+        for (size_t j = 0; j < rl->size(); ++j) {
+            if (l->push(rl->retrieveEntry(j).refSelf(), xsink))
+                return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlRecordParser.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_XML_RECORD_PARSER_H
+#define _QORE_XML_RECORD_PARSER_H
+
+#include "qore-xml-module.h"
+#include "QoreXmlDataBuilder.h"
+#include "XmlRecordScanner.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+//! the number of bytes of records parsed as one document
+#define XML_RECORD_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * Parses the record elements of a large document in chunks, optionally with a pool of worker threads.
+ *
+ * The records are found with XmlRecordScanner; each chunk of records is parsed as a separate document with the
+ * prolog and the root element of the document, and the values of the records are returned in document order.  With
+ * worker threads, the scanner is shared by the workers, which take the next chunk and parse it; the calling thread
+ * adds the values of the chunks to the list in order.  Workers stay at most two chunks per thread ahead of the
+ * output.  Each thread parses its chunks with a single libxml2 parser context that is reset for each chunk.
+ *
+ * Without worker threads, the document is parsed as a whole with a select path for the records when possible, as
+ * copying the records into chunk documents is slower than parsing the other content of the document.
+ */
+class XmlRecordParser {
+public:
+    DLLLOCAL XmlRecordParser(const char* buf, size_t len, const char* element, const char* encoding, int options,
+            const QoreEncoding* data_ccsid, int pflags, XmlDataOpts* dopts, unsigned threads)
+            : buf(buf), len(len), element(element), scanner(buf, len, element), encoding(encoding), options(options), data_ccsid(data_ccsid),
+            pflags(pflags), dopts(dopts), threads(threads) {
+    }
+
+    DLLLOCAL ~XmlRecordParser();
+
+    //! returns the values of the records or nullptr if an exception was raised
+    DLLLOCAL QoreListNode* parse(ExceptionSink* xsink);
+
+private:
+    struct Chunk {
+        XmlRecordChunk records;
+        ExceptionSink xsink;
+        //! the document parsed from the chunk
+        ReferenceHolder<QoreHashNode> h;
+        bool done = false;
+
+        DLLLOCAL Chunk() : h(&xsink) {
+        }
+    };
+
+    const char* buf;
+    size_t len;
+    //! the name of the records
+    const char* element;
+    XmlRecordScanner scanner;
+    const char* encoding;
+    int options;
+    const QoreEncoding* data_ccsid;
+    int pflags;
+    XmlDataOpts* dopts;
+    unsigned threads;
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+
+    QoreThreadLock lck;
+    QoreCondition cond;
+    // the number of chunks added to the output
+    size_t consumed = 0;
+    // the number of running workers
+    unsigned running = 0;
+    // true when all records have been found
+    bool scan_done = false;
+    bool stop = false;
+
+    //! parses the records in the calling thread
+    DLLLOCAL int parseSerial(ExceptionSink* xsink, QoreListNode* l);
+
+    /** parses the whole document in the calling thread, selecting the records
+        @return 0 = OK, -1 = error (exception raised), 1 = the document must be parsed in chunks
+    */
+    DLLLOCAL int parseWhole(ExceptionSink* xsink, QoreListNode* l);
+
+    //! parses the records with worker threads
+    DLLLOCAL int parseParallel(ExceptionSink* xsink, QoreListNode* l);
+
+    DLLLOCAL static void worker(ExceptionSink* xsink, void* arg) {
+        static_cast<XmlRecordParser*>(arg)->work();
+    }
+
+    DLLLOCAL void work();
+
+    //! parses the records of the chunk as a document; the document buffer and the parser context are reused between
+    //! chunks
+    DLLLOCAL void parseChunk(Chunk& c, XmlDataOpts* opts, std::string& doc, XmlSaxParserContext& ctxt);
+
+    //! adds the values of the records in the chunk to the list
+    DLLLOCAL static int addRecords(ExceptionSink* xsink, QoreListNode* l, const QoreHashNode* h);
+};
+
+#endif
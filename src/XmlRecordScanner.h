@@ -0,0 +1,357 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlRecordScanner.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _QORE_XML_RECORD_SCANNER_H
+#define _QORE_XML_RECORD_SCANNER_H
+
+// this file does not depend on the Qore library
+#include <stddef.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef DLLLOCAL
+#define DLLLOCAL
+#endif
+
+//! a range of record elements found by XmlRecordScanner
+struct XmlRecordChunk {
+    //! the byte ranges of the records; records only separated by whitespace are in the same range
+    std::vector<std::pair<size_t, size_t>> ranges;
+    //! the number of records
+    size_t count = 0;
+    //! the number of bytes in all ranges
+    size_t size = 0;
+
+    DLLLOCAL void clear() {
+        ranges.clear();
+        count = 0;
+        size = 0;
+    }
+};
+
+//! finds the boundaries of record elements in an XML document without parsing it
+/** Records are the children of the root element with a given name; a name without a namespace prefix matches the
+    local name of elements, a name with a prefix matches the qualified name.  Each chunk of records can be parsed as
+    a separate document made of the prolog of the document, the start tag of the root element, the records and the
+    end tag of the root element, so the records see all namespace declarations and entities of the document.
+
+    The scanner only recognizes the markup needed to find element boundaries: tags, comments, CDATA sections,
+    processing instructions and the document type declaration.  It does not check that the document is well-formed;
+    malformed records are reported by the parser of the chunk.  The document must be in an ASCII-compatible encoding.
+*/
+class XmlRecordScanner {
+public:
+    DLLLOCAL XmlRecordScanner(const char* buf, size_t len, const char* name) : buf(buf), len(len), name(name),
+            name_len(strlen(name)), local(!strchr(name, ':')) {
+    }
+
+    /** finds the root element
+        @return 0 = OK, -1 = no root element found
+    */
+    DLLLOCAL int init() {
+        size_t p = 0;
+        // skip a UTF-8 byte order mark
+        if (len >= 3 && !memcmp(buf, "\xef\xbb\xbf", 3))
+            p = 3;
+        while (true) {
+            p = skipSpace(p);
+            if (p >= len || buf[p] != '<')
+                return -1;
+            if (startsWith(p, "<?")) {
+                p = skipPast(p + 2, "?>");
+            } else if (startsWith(p, "<!--")) {
+                p = skipPast(p + 4, "-->");
+            } else if (startsWith(p, "<!")) {
+                p = skipDeclaration(p + 2);
+            } else {
+                break;
+            }
+        }
+
+        root_start = p;
+        size_t n = nameEnd(p + 1);
+        if (n == p + 1)
+            return -1;
+        root_name.assign(buf + p + 1, n - p - 1);
+        bool empty;
+        pos = tagEnd(n, empty);
+        if (pos > len)
+            return -1;
+        root_end = pos;
+        // an empty root element has no records
+        done = empty;
+        return 0;
+    }
+
+    //! returns the offset of the start tag of the root element; the data before it is the prolog of the document
+    DLLLOCAL size_t getRootStart() const {
+        return root_start;
+    }
+
+    //! returns the offset after the start tag of the root element
+    DLLLOCAL size_t getRootEnd() const {
+        return root_end;
+    }
+
+    //! returns the qualified name of the root element
+    DLLLOCAL const std::string& getRootName() const {
+        return root_name;
+    }
+
+    //! returns true if the end of the document was reached before the end tag of the root element
+    DLLLOCAL bool truncated() const {
+        return is_truncated;
+    }
+
+    /** finds the next records with the same qualified name
+        @param chunk the records found; records are added until the total size reaches \a max_size bytes
+        @param max_size the maximum size of the chunk; a chunk has at least one record
+        @return true if any records were found, false if there are no more records
+    */
+    DLLLOCAL bool next(XmlRecordChunk& chunk, size_t max_size) {
+        chunk.clear();
+        // the name of the records in the chunk
+        size_t qname = 0, qname_len = 0;
+        // true if the last node was a record or whitespace after it
+        bool adjacent = false;
+
+        while (!done && chunk.size < max_size) {
+            size_t lt = findChar(pos, '<');
+            if (lt >= len) {
+                // the root element is not closed
+                is_truncated = true;
+                done = true;
+                break;
+            }
+            // text other than whitespace separates records
+            if (adjacent && skipSpace(pos) < lt)
+                adjacent = false;
+
+            if (startsWith(lt, "</")) {
+                // the end of the root element
+                pos = skipPast(lt + 2, ">");
+                done = true;
+                break;
+            }
+            if (startsWith(lt, "<?")) {
+                pos = skipPast(lt + 2, "?>");
+                adjacent = false;
+                continue;
+            }
+            if (startsWith(lt, "<!--")) {
+                pos = skipPast(lt + 4, "-->");
+                adjacent = false;
+                continue;
+            }
+            if (startsWith(lt, "<![CDATA[")) {
+                pos = skipPast(lt + 9, "]]>");
+                adjacent = false;
+                continue;
+            }
+            if (startsWith(lt, "<!")) {
+                pos = skipDeclaration(lt + 2);
+                adjacent = false;
+                continue;
+            }
+
+            size_t n = nameEnd(lt + 1);
+            bool record = matchName(lt + 1, n);
+            // records with a different qualified name are returned in the next chunk
+            if (record && chunk.count && (n - lt - 1 != qname_len || memcmp(buf + lt + 1, buf + qname, qname_len)))
+                break;
+
+            size_t end = elementEnd(n);
+            pos = end;
+            if (!record) {
+                adjacent = false;
+                continue;
+            }
+            if (!chunk.count) {
+                qname = lt + 1;
+                qname_len = n - lt - 1;
+            }
+            if (adjacent) {
+                chunk.size += end - chunk.ranges.back().second;
+                chunk.ranges.back().second = end;
+            } else {
+                chunk.size += end - lt;
+                chunk.ranges.push_back(std::make_pair(lt, end));
+            }
+            ++chunk.count;
+            adjacent = true;
+        }
+        return chunk.count > 0;
+    }
+
+private:
+    const char* buf;
+    size_t len;
+    const char* name;
+    size_t name_len;
+    //! true if the name has no namespace prefix
+    bool local;
+
+    std::string root_name;
+    size_t root_start = 0;
+    size_t root_end = 0;
+    //! the current position in the content of the root element
+    size_t pos = 0;
+    bool done = false;
+    bool is_truncated = false;
+
+    DLLLOCAL bool startsWith(size_t p, const char* str) const {
+        size_t l = strlen(str);
+        return p + l <= len && !memcmp(buf + p, str, l);
+    }
+
+    DLLLOCAL static bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    DLLLOCAL size_t skipSpace(size_t p) const {
+        while (p < len && isSpace(buf[p]))
+            ++p;
+        return p;
+    }
+
+    //! returns the offset of the character or len if not found
+    DLLLOCAL size_t findChar(size_t p, char c) const {
+        if (p >= len)
+            return len;
+        const char* f = (const char*)memchr(buf + p, c, len - p);
+        return f ? f - buf : len;
+    }
+
+    //! returns the offset after the string or len if not found
+    DLLLOCAL size_t skipPast(size_t p, const char* str) const {
+        size_t l = strlen(str);
+        while (true) {
+            p = findChar(p, *str);
+            if (p >= len)
+                return len;
+            if (p + l <= len && !memcmp(buf + p, str, l))
+                return p + l;
+            ++p;
+        }
+    }
+
+    //! returns the end of the name starting at the offset
+    DLLLOCAL size_t nameEnd(size_t p) const {
+        while (p < len && !isSpace(buf[p]) && buf[p] != '/' && buf[p] != '>')
+            ++p;
+        return p;
+    }
+
+    //! returns the offset after the end of the tag; quoted attribute values may contain '>'
+    DLLLOCAL size_t tagEnd(size_t p, bool& empty) const {
+        char quote = 0;
+        for (; p < len; ++p) {
+            char c = buf[p];
+            if (quote) {
+                if (c == quote)
+                    quote = 0;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '>') {
+                empty = buf[p - 1] == '/';
+                return p + 1;
+            }
+        }
+        empty = false;
+        return len;
+    }
+
+    //! skips a declaration such as <!DOCTYPE ...> with an internal subset in brackets
+    DLLLOCAL size_t skipDeclaration(size_t p) const {
+        char quote = 0;
+        int brackets = 0;
+        for (; p < len; ++p) {
+            char c = buf[p];
+            if (quote) {
+                if (c == quote)
+                    quote = 0;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '[') {
+                ++brackets;
+            } else if (c == ']') {
+                --brackets;
+            } else if (c == '<' && startsWith(p, "<!--")) {
+                p = skipPast(p + 4, "-->") - 1;
+            } else if (c == '>' && brackets <= 0) {
+                return p + 1;
+            }
+        }
+        return len;
+    }
+
+    //! returns the offset after the element whose name ends at the given offset, including its content
+    DLLLOCAL size_t elementEnd(size_t p) const {
+        bool empty;
+        p = tagEnd(p, empty);
+        if (empty)
+            return p;
+
+        int depth = 1;
+        while (p < len) {
+            p = findChar(p, '<');
+            if (p >= len)
+                break;
+            if (startsWith(p, "</")) {
+                p = skipPast(p + 2, ">");
+                if (!--depth)
+                    return p;
+            } else if (startsWith(p, "<!--")) {
+                p = skipPast(p + 4, "-->");
+            } else if (startsWith(p, "<![CDATA[")) {
+                p = skipPast(p + 9, "]]>");
+            } else if (startsWith(p, "<?")) {
+                p = skipPast(p + 2, "?>");
+            } else if (startsWith(p, "<!")) {
+                p = skipDeclaration(p + 2);
+            } else {
+                p = tagEnd(p + 1, empty);
+                if (!empty)
+                    ++depth;
+            }
+        }
+        // the element is not closed; the parser reports the error
+        return len;
+    }
+
+    //! returns true if the name from start to end is the name of the records
+    DLLLOCAL bool matchName(size_t start, size_t end) const {
+        if (local) {
+            const char* c = (const char*)memchr(buf + start, ':', end - start);
+            if (c)
+                start = c - buf + 1;
+        }
+        return end - start == name_len && !memcmp(buf + start, name, name_len);
+    }
+};
+
+#endif
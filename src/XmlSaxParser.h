@@ -0,0 +1,484 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlSaxParser.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_XML_SAX_PARSER_H
+#define _QORE_XML_SAX_PARSER_H
+
+// this file does not depend on the Qore library so that the parser can be benchmarked standalone
+#include <libxml/parser.h>
+#include <libxml/parserInternals.h>
+#include <libxml/SAX2.h>
+#include <libxml/dict.h>
+
+#include <limits.h>
+#include <string.h>
+
+#include <string>
+
+#ifndef DLLLOCAL
+#define DLLLOCAL
+#endif
+
+//! the error argument type of xmlStructuredErrorFunc, which is const in some libxml2 versions
+template <typename F>
+struct XmlSaxErrorArg;
+
+template <typename A>
+struct XmlSaxErrorArg<void (*)(void*, A)> {
+    typedef A type;
+};
+
+//! a libxml2 parser context that is reused for parsing documents from memory one after the other in one thread
+/** The context is reset with xmlCtxtReset() for each document after the first one, which keeps its buffers and its
+    dictionary, so names that are repeated in the documents are only added to the dictionary once.
+*/
+class XmlSaxParserContext {
+public:
+    DLLLOCAL XmlSaxParserContext() {
+    }
+
+    DLLLOCAL ~XmlSaxParserContext() {
+        if (ctxt)
+            xmlFreeParserCtxt(ctxt);
+    }
+
+    //! returns the context set up to parse the document in the buffer, or nullptr if it could not be created
+    DLLLOCAL xmlParserCtxtPtr get(const char* buf, int len) {
+        if (!ctxt)
+            return ctxt = xmlCreateMemoryParserCtxt(buf, len);
+        // set up the input as xmlCreateMemoryParserCtxt() does
+        xmlCtxtReset(ctxt);
+        xmlParserInputBufferPtr in = xmlParserInputBufferCreateMem(buf, len, XML_CHAR_ENCODING_NONE);
+        if (!in)
+            return nullptr;
+        xmlParserInputPtr stream = xmlNewIOInputStream(ctxt, in, XML_CHAR_ENCODING_NONE);
+        if (!stream) {
+            xmlFreeParserInputBuffer(in);
+            return nullptr;
+        }
+        inputPush(ctxt, stream);
+        return ctxt;
+    }
+
+private:
+    xmlParserCtxtPtr ctxt = nullptr;
+
+    DLLLOCAL XmlSaxParserContext(const XmlSaxParserContext&) = delete;
+    DLLLOCAL XmlSaxParserContext& operator=(const XmlSaxParserContext&) = delete;
+};
+
+//! delivers the nodes of an XML document to a handler in the same form as they are read with xmlTextReader
+/** The document is parsed with libxml2's SAX2 interface without building a tree.  The handler receives the same
+    sequence of nodes with the same names, values and depths as xmlTextReader returns for the tree built from the
+    document with the same options:
+    - adjacent character data is merged into one text node; adjacent CDATA sections are merged into one CDATA node
+    - text nodes consisting only of whitespace are not delivered; other text nodes are delivered with all their
+      whitespace
+    - element and attribute names include any namespace prefix; namespace declarations are delivered as attributes
+      before the other attributes of the element
+
+    Empty documents, documents larger than INT_MAX bytes and documents with a document type declaration are not
+    supported, as DTDs can add nodes, attributes and entity references; parse() returns 1 for such documents without
+    finishing the parse, so the caller can parse them with xmlTextReader instead.  parse() also returns 1 if the
+    encoding given is not known to libxml2, and for documents where xmlTextReader may drop whitespace as ignorable
+    with XML_PARSE_NOBLANKS: text that starts with whitespace before a carriage return, and whitespace between CDATA
+    sections.  Whether libxml2 drops such whitespace depends on where the input is split into blocks.
+
+    The handler must provide the following methods; a non-zero return value stops the parse:
+    - <tt>int element(const char* name, int depth)</tt>
+    - <tt>bool skipSubtree()</tt>: after element(); if true, the element's attributes and subtree are not delivered
+    - <tt>int attribute(const char* name, const char* value, size_t len)</tt>: for each attribute of the last element
+    - <tt>int endAttributes()</tt>: after the last attribute of an element, if the element has attributes
+    - <tt>int text(const char* str, size_t len, int depth)</tt>
+    - <tt>int cdata(const char* str, size_t len, int depth)</tt>
+    - <tt>int comment(const char* str, size_t len, int depth)</tt>
+
+    Strings passed to text(), cdata() and comment() are null-terminated; names remain valid until the parse is
+    finished.
+*/
+template <typename H>
+class XmlSaxParser {
+public:
+    DLLLOCAL XmlSaxParser(H& handler, bool strip_ns_prefixes) : handler(handler),
+            strip_ns_prefixes(strip_ns_prefixes) {
+    }
+
+    //! parses the document
+    /** @param encoding the encoding of the document, which libxml2 decodes instead of any encoding given in the XML
+        declaration, or nullptr to use the encoding detected by libxml2
+        @param reuse a context to parse the document with, or nullptr to parse it with a new context
+
+        @return 0 = OK, -1 = error (the handler stopped the parse or see getError()), 1 = the document is not
+        supported and must be parsed with xmlTextReader
+    */
+    DLLLOCAL int parse(const char* buf, size_t len, int options, const char* encoding = nullptr,
+            XmlSaxParserContext* reuse = nullptr) {
+        // empty documents are left to xmlTextReader for the error message
+        if (!len || len > INT_MAX) {
+            unsupported = true;
+            return 1;
+        }
+        ctxt = reuse ? reuse->get(buf, (int)len) : xmlCreateMemoryParserCtxt(buf, (int)len);
+        if (!ctxt) {
+            error = "could not create XML parser";
+            return -1;
+        }
+        if (encoding) {
+            xmlCharEncodingHandlerPtr enc_handler = xmlFindCharEncodingHandler(encoding);
+            if (!enc_handler) {
+                if (!reuse)
+                    xmlFreeParserCtxt(ctxt);
+                ctxt = nullptr;
+                unsupported = unsupported_encoding = true;
+                return 1;
+            }
+            // the parser context takes ownership of the handler
+            xmlSwitchToEncoding(ctxt, enc_handler);
+#if LIBXML_VERSION >= 20800
+            options |= XML_PARSE_IGNORE_ENC;
+#endif
+        }
+
+        xmlSAXHandler sax;
+        memset(&sax, 0, sizeof sax);
+        sax.initialized = XML_SAX2_MAGIC;
+        sax.startElementNs = startElementNs;
+        sax.endElementNs = endElementNs;
+        sax.characters = characters;
+        sax.cdataBlock = cdataBlock;
+        sax.comment = comment;
+        sax.processingInstruction = processingInstruction;
+        sax.internalSubset = internalSubset;
+        sax.reference = reference;
+        sax.serror = structuredError;
+        memcpy(ctxt->sax, &sax, sizeof sax);
+        ctxt->userData = this;
+        xmlCtxtUseOptions(ctxt, options);
+
+        xmlParseDocument(ctxt);
+
+        int rc;
+        if (unsupported) {
+            rc = 1;
+        } else if (stopped) {
+            rc = -1;
+        } else if (!error.empty()) {
+            rc = -1;
+        } else if (!ctxt->wellFormed || depth) {
+            const xmlError* e = xmlCtxtGetLastError(ctxt);
+            error = e && e->message ? e->message : "error parsing XML string";
+            rc = -1;
+        } else {
+            rc = 0;
+        }
+        if (!reuse)
+            xmlFreeParserCtxt(ctxt);
+        ctxt = nullptr;
+        return rc;
+    }
+
+    //! returns true if the encoding passed to parse() is not known to libxml2
+    DLLLOCAL bool unsupportedEncoding() const {
+        return unsupported_encoding;
+    }
+
+    //! returns the first error reported by libxml2
+    DLLLOCAL const std::string& getError() const {
+        return error;
+    }
+
+private:
+    enum PendingType {
+        XSP_NONE,
+        XSP_TEXT,
+        XSP_CDATA,
+    };
+
+    H& handler;
+    bool strip_ns_prefixes;
+    xmlParserCtxtPtr ctxt = nullptr;
+    //! the number of open elements
+    int depth = 0;
+    //! the depth of the element whose subtree is skipped, or -1
+    int skip_depth = -1;
+    //! character data not yet delivered
+    std::string pending;
+    PendingType pending_type = XSP_NONE;
+    //! the pending text contains characters other than whitespace
+    bool pending_text = false;
+    //! the pending text starts with whitespace that xmlTextReader may drop as ignorable
+    bool pending_ignorable = false;
+    //! the last node delivered is a CDATA section, possibly followed by whitespace
+    bool cdata_last = false;
+    //! the handler stopped the parse
+    bool stopped = false;
+    bool unsupported = false;
+    bool unsupported_encoding = false;
+    std::string error;
+    //! a buffer for decoding attribute values
+    std::string attr_value;
+
+    DLLLOCAL static XmlSaxParser* get(void* ctx) {
+        return static_cast<XmlSaxParser*>(ctx);
+    }
+
+    DLLLOCAL void stop() {
+        stopped = true;
+        xmlStopParser(ctxt);
+    }
+
+    DLLLOCAL static bool isBlank(const char* p, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            char c = p[i];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+                return false;
+        }
+        return true;
+    }
+
+    //! delivers any pending character data
+    DLLLOCAL int flush() {
+        if (pending_type == XSP_NONE)
+            return 0;
+        int rc = 0;
+        if (pending_type == XSP_CDATA) {
+            rc = handler.cdata(pending.c_str(), pending.size(), depth);
+            cdata_last = true;
+        // text nodes consisting only of whitespace are skipped
+        } else if (pending_text) {
+            if (pending_ignorable)
+                return setUnsupported();
+            rc = handler.text(pending.c_str(), pending.size(), depth);
+            cdata_last = false;
+        }
+        pending.clear();
+        pending_type = XSP_NONE;
+        pending_text = pending_ignorable = false;
+        if (rc)
+            stop();
+        return rc;
+    }
+
+    //! stops the parse so that the document is parsed with xmlTextReader
+    DLLLOCAL int setUnsupported() {
+        unsupported = true;
+        xmlStopParser(ctxt);
+        return -1;
+    }
+
+    //! decodes an attribute value containing references to '&'
+    /** libxml2 reports '&' characters in attribute values as "&#38;" so that they can be distinguished from entity
+        references; all other references have already been replaced.
+
+        @return 0 = OK, -1 = the value contains an entity reference and the parse has been stopped
+    */
+    DLLLOCAL int decodeAttributeValue(const char* value, size_t len) {
+        attr_value.clear();
+        const char* e = value + len;
+        while (value < e) {
+            const char* p = (const char*)memchr(value, '&', e - value);
+            if (!p) {
+                attr_value.append(value, e - value);
+                break;
+            }
+            if (e - p < 5 || memcmp(p, "&#38;", 5))
+                return setUnsupported();
+            attr_value.append(value, p - value);
+            attr_value += '&';
+            value = p + 5;
+        }
+        return 0;
+    }
+
+    //! returns the qualified name for the given prefix and local name
+    DLLLOCAL const char* qname(const xmlChar* prefix, const xmlChar* localname) const {
+        if (!prefix)
+            return (const char*)localname;
+        return (const char*)xmlDictQLookup(ctxt->dict, prefix, localname);
+    }
+
+    DLLLOCAL static void startElementNs(void* ctx, const xmlChar* localname, const xmlChar* prefix,
+            const xmlChar* URI, int nb_namespaces, const xmlChar** namespaces, int nb_attributes,
+            int nb_defaulted, const xmlChar** attributes) {
+        XmlSaxParser* p = get(ctx);
+        if (p->skip_depth >= 0) {
+            ++p->depth;
+            return;
+        }
+        if (p->stopped || p->flush())
+            return;
+        p->cdata_last = false;
+
+        const char* name = p->strip_ns_prefixes ? (const char*)localname : p->qname(prefix, localname);
+        if (!name) {
+            p->error = "out of memory";
+            p->stop();
+            return;
+        }
+        if (p->handler.element(name, p->depth)) {
+            p->stop();
+            return;
+        }
+        if (p->handler.skipSubtree()) {
+            p->skip_depth = p->depth++;
+            return;
+        }
+
+        if (nb_namespaces || nb_attributes) {
+            for (int i = 0; i < nb_namespaces; ++i) {
+                const xmlChar* nsprefix = namespaces[i * 2];
+                const char* nsname = nsprefix ? p->qname((const xmlChar*)"xmlns", nsprefix) : "xmlns";
+                const char* href = (const char*)namespaces[i * 2 + 1];
+                if (!nsname) {
+                    p->error = "out of memory";
+                    p->stop();
+                    return;
+                }
+                if (p->handler.attribute(nsname, href ? href : "", href ? strlen(href) : 0)) {
+                    p->stop();
+                    return;
+                }
+            }
+            for (int i = 0; i < nb_attributes; ++i) {
+                const xmlChar** a = attributes + i * 5;
+                const char* aname = p->qname(a[1], a[0]);
+                if (!aname) {
+                    p->error = "out of memory";
+                    p->stop();
+                    return;
+                }
+                const char* value = (const char*)a[3];
+                size_t vlen = a[4] - a[3];
+                if (memchr(value, '&', vlen)) {
+                    if (p->decodeAttributeValue(value, vlen))
+                        return;
+                    value = p->attr_value.c_str();
+                    vlen = p->attr_value.size();
+                }
+                if (p->handler.attribute(aname, value, vlen)) {
+                    p->stop();
+                    return;
+                }
+            }
+            if (p->handler.endAttributes()) {
+                p->stop();
+                return;
+            }
+        }
+
+        ++p->depth;
+    }
+
+    DLLLOCAL static void endElementNs(void* ctx, const xmlChar* localname, const xmlChar* prefix,
+            const xmlChar* URI) {
+        XmlSaxParser* p = get(ctx);
+        if (p->skip_depth >= 0) {
+            if (--p->depth == p->skip_depth)
+                p->skip_depth = -1;
+            return;
+        }
+        if (p->stopped || p->flush())
+            return;
+        p->cdata_last = false;
+        --p->depth;
+    }
+
+    DLLLOCAL static void characters(void* ctx, const xmlChar* ch, int len) {
+        XmlSaxParser* p = get(ctx);
+        if (p->stopped || p->skip_depth >= 0)
+            return;
+        if (p->pending_type != XSP_TEXT) {
+            if (p->flush())
+                return;
+            p->pending_type = XSP_TEXT;
+        }
+        if (!p->pending_text) {
+            if (p->isBlank((const char*)ch, len)) {
+                // when building a tree, libxml2 drops whitespace before a carriage return as ignorable unless text
+                // precedes it in the element or the input is split in the whitespace
+                if (p->ctxt->input->cur[0] == 0xd && (!p->ctxt->space || *p->ctxt->space != 1))
+                    p->pending_ignorable = true;
+            } else {
+                p->pending_text = true;
+            }
+        }
+        p->pending.append((const char*)ch, len);
+    }
+
+    DLLLOCAL static void cdataBlock(void* ctx, const xmlChar* value, int len) {
+        XmlSaxParser* p = get(ctx);
+        if (p->stopped || p->skip_depth >= 0)
+            return;
+        if (p->pending_type != XSP_CDATA) {
+            bool blank_text = p->pending_type == XSP_TEXT && !p->pending_text;
+            if (p->flush())
+                return;
+            // libxml2 merges CDATA sections separated by whitespace that it drops as ignorable
+            if (blank_text && p->cdata_last) {
+                p->setUnsupported();
+                return;
+            }
+            p->pending_type = XSP_CDATA;
+        }
+        p->pending.append((const char*)value, len);
+    }
+
+    DLLLOCAL static void comment(void* ctx, const xmlChar* value) {
+        XmlSaxParser* p = get(ctx);
+        if (p->stopped || p->skip_depth >= 0 || p->flush())
+            return;
+        p->cdata_last = false;
+        if (p->handler.comment((const char*)value, strlen((const char*)value), p->depth))
+            p->stop();
+    }
+
+    DLLLOCAL static void processingInstruction(void* ctx, const xmlChar* target, const xmlChar* data) {
+        XmlSaxParser* p = get(ctx);
+        if (p->stopped || p->skip_depth >= 0 || p->flush())
+            return;
+        p->cdata_last = false;
+    }
+
+    DLLLOCAL static void internalSubset(void* ctx, const xmlChar* name, const xmlChar* ExternalID,
+            const xmlChar* SystemID) {
+        XmlSaxParser* p = get(ctx);
+        p->unsupported = true;
+        xmlStopParser(p->ctxt);
+    }
+
+    DLLLOCAL static void reference(void* ctx, const xmlChar* name) {
+        XmlSaxParser* p = get(ctx);
+        p->unsupported = true;
+        xmlStopParser(p->ctxt);
+    }
+
+    DLLLOCAL static void structuredError(void* ctx, typename XmlSaxErrorArg<xmlStructuredErrorFunc>::type e) {
+        if (e->level < XML_ERR_ERROR)
+            return;
+        XmlSaxParser* p = get(ctx);
+        if (p->error.empty() && !p->unsupported)
+            p->error = e->message ? e->message : "error parsing XML string";
+    }
+};
+
+#endif
@@ -0,0 +1,89 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlThreadPool.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "XmlThreadPool.h"
+
+#include <thread>
+
+XmlThreadPool xml_thread_pool;
+
+XmlThreadPool::XmlThreadPool() : max_workers(std::thread::hardware_concurrency()) {
+    if (!max_workers)
+        max_workers = 4;
+}
+
+int XmlThreadPool::submit(ExceptionSink* xsink, AbstractXmlThreadPoolTask* task) {
+    AutoLocker al(lck);
+    tasks.push_back(task);
+    if (idle >= tasks.size() || workers == max_workers) {
+        cond.signal();
+        return 0;
+    }
+
+    ExceptionSink xsink2;
+    ++workers;
+    if (q_start_thread(&xsink2, worker, this) == -1) {
+        --workers;
+        // the task is run by the running workers if there are any
+        if (!workers) {
+            tasks.pop_back();
+            xsink->assimilate(xsink2);
+            return -1;
+        }
+        xsink2.clear();
+    }
+    return 0;
+}
+
+void XmlThreadPool::shutdown() {
+    AutoLocker al(lck);
+    stopped = true;
+    cond.broadcast();
+    while (workers)
+        cond.wait(lck);
+}
+
+void XmlThreadPool::work() {
+    lck.lock();
+    while (true) {
+        if (tasks.empty()) {
+            if (stopped)
+                break;
+            ++idle;
+            cond.wait(lck, XML_THREAD_POOL_IDLE_MS);
+            --idle;
+            // exit after a timeout without new tasks
+            if (tasks.empty())
+                break;
+        }
+        AbstractXmlThreadPoolTask* task = tasks.front();
+        tasks.pop_front();
+        lck.unlock();
+        task->run();
+        lck.lock();
+    }
+    --workers;
+    cond.broadcast();
+    lck.unlock();
+}
@@ -0,0 +1,89 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlThreadPool.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _QORE_XML_THREAD_POOL_H
+#define _QORE_XML_THREAD_POOL_H
+
+#include "qore-xml-module.h"
+
+#include <deque>
+
+// the number of milliseconds that an idle worker waits for new tasks before it exits
+#define XML_THREAD_POOL_IDLE_MS 200
+
+/**
+ * A task run by a worker thread of the XML thread pool.
+ */
+class AbstractXmlThreadPoolTask {
+public:
+    DLLLOCAL virtual ~AbstractXmlThreadPoolTask() {
+    }
+
+    //! runs the task in a worker thread
+    DLLLOCAL virtual void run() = 0;
+};
+
+/**
+ * A pool of worker threads shared by all serialization calls with the "parallel" option.
+ *
+ * Tasks are run in the order they are submitted by at most one worker per CPU, however many calls use the pool at
+ * the same time.  Workers are started on demand and exit after being idle for XML_THREAD_POOL_IDLE_MS milliseconds,
+ * so no threads are left running when the pool is not in use.  Tasks must not wait for other tasks.
+ */
+class XmlThreadPool {
+public:
+    DLLLOCAL XmlThreadPool();
+
+    /**
+     * Queues a task; a worker is started if no worker is idle and the pool is not full.
+     * @returns 0 = OK, -1 = error (exception raised; the task was not queued)
+     */
+    DLLLOCAL int submit(ExceptionSink* xsink, AbstractXmlThreadPoolTask* task);
+
+    //! waits for all workers to exit; called when the module is deleted
+    DLLLOCAL void shutdown();
+
+private:
+    QoreThreadLock lck;
+    QoreCondition cond;
+    std::deque<AbstractXmlThreadPoolTask*> tasks;
+    //! the maximum number of workers
+    unsigned max_workers;
+    //! the number of running workers
+    unsigned workers = 0;
+    //! the number of workers waiting for tasks
+    unsigned idle = 0;
+    bool stopped = false;
+
+    DLLLOCAL static void worker(ExceptionSink* xsink, void* arg) {
+        static_cast<XmlThreadPool*>(arg)->work();
+    }
+
+    DLLLOCAL void work();
+};
+
+//! the thread pool for the module
+DLLLOCAL extern XmlThreadPool xml_thread_pool;
+
+#endif
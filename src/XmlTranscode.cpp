@@ -0,0 +1,86 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlTranscode.cpp
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlTranscode.h"
+
+#include <errno.h>
+
+int XmlTranscoder::init(ExceptionSink* xsink, const QoreEncoding* e) {
+    assert(cd == (iconv_t)-1);
+    enc = e;
+    cd = iconv_open(enc->getCode(), "UTF-8");
+    if (cd == (iconv_t)-1) {
+        xsink->raiseException("ENCODING-CONVERSION-ERROR", "cannot convert from \"UTF-8\" to \"%s\"",
+            enc->getCode());
+        return -1;
+    }
+    return 0;
+}
+
+int XmlTranscoder::convert(ExceptionSink* xsink, const char* data, size_t len, QoreString& out) {
+    if (pending.empty())
+        return convertIntern(xsink, data, len, out);
+
+    std::string tmp;
+    tmp.swap(pending);
+    tmp.append(data, len);
+    return convertIntern(xsink, tmp.data(), tmp.size(), out);
+}
+
+int XmlTranscoder::convertIntern(ExceptionSink* xsink, const char* data, size_t len, QoreString& out) {
+    char* in = const_cast<char*>(data);
+    size_t in_left = len;
+    while (in_left) {
+        char* o = obuf.data();
+        size_t o_left = obuf.size();
+        size_t rc = iconv(cd, &in, &in_left, &o, &o_left);
+        out.concat(obuf.data(), obuf.size() - o_left);
+        if (rc != (size_t)-1)
+            break;
+        if (errno == E2BIG)
+            continue;
+        if (errno == EINVAL) {
+            // incomplete multi-byte sequence at the end of the block
+            pending.assign(in, in_left);
+            break;
+        }
+        xsink->raiseException("ENCODING-CONVERSION-ERROR", "illegal character sequence found in input type "
+            "\"UTF-8\" (while converting to \"%s\")", enc->getCode());
+        return -1;
+    }
+    return 0;
+}
+
+int XmlTranscoder::finish(ExceptionSink* xsink, QoreString& out) {
+    if (!pending.empty()) {
+        xsink->raiseException("ENCODING-CONVERSION-ERROR", "incomplete character sequence found at the end of "
+            "input type \"UTF-8\" (while converting to \"%s\")", enc->getCode());
+        return -1;
+    }
+    // write any sequence needed to return to the initial shift state
+    char* o = obuf.data();
+    size_t o_left = obuf.size();
+    iconv(cd, nullptr, nullptr, &o, &o_left);
+    out.concat(obuf.data(), obuf.size() - o_left);
+    return 0;
+}
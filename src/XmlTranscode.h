@@ -0,0 +1,126 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    XmlTranscode.h
+
+    Qore Programming Language
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _QORE_XML_TRANSCODE_H
+#define _QORE_XML_TRANSCODE_H
+
+#include "qore-xml-module.h"
+#include "MakeXmlOutput.h"
+
+#include <iconv.h>
+
+#include <string>
+#include <vector>
+
+// size of the buffer for converted output
+#define XML_TRANSCODE_BUFFER_SIZE (64 * 1024)
+
+/**
+ * Converts UTF-8 XML output to another encoding with iconv.
+ *
+ * The conversion descriptor is opened once and reused for all blocks; an
+ * incomplete multi-byte sequence at the end of a block is kept and converted
+ * with the next block.
+ */
+class XmlTranscoder {
+public:
+    DLLLOCAL XmlTranscoder() : obuf(XML_TRANSCODE_BUFFER_SIZE) {
+    }
+
+    DLLLOCAL ~XmlTranscoder() {
+        if (cd != (iconv_t)-1)
+            iconv_close(cd);
+    }
+
+    /**
+     * Opens the conversion from UTF-8 to the given encoding.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int init(ExceptionSink* xsink, const QoreEncoding* enc);
+
+    /**
+     * Converts a block of UTF-8 data and appends the result to \a out.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int convert(ExceptionSink* xsink, const char* data, size_t len, QoreString& out);
+
+    /**
+     * Ends the conversion, appending any final shift sequence to \a out.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int finish(ExceptionSink* xsink, QoreString& out);
+
+    /**
+     * Returns true if make_xml() output in the encoding is serialized in
+     * UTF-8 and converted in blocks; only ASCII-compatible encodings are
+     * converted this way, since the XML header is written in ASCII.
+     */
+    DLLLOCAL static bool useFor(const QoreEncoding* enc) {
+        return enc != QCS_UTF8 && enc->isAsciiCompat();
+    }
+
+private:
+    iconv_t cd = (iconv_t)-1;
+    const QoreEncoding* enc = nullptr;
+    //! an incomplete sequence at the end of the last block
+    std::string pending;
+    std::vector<char> obuf;
+
+    DLLLOCAL int convertIntern(ExceptionSink* xsink, const char* data, size_t len, QoreString& out);
+};
+
+/**
+ * Converts serialized UTF-8 XML data to the document encoding and writes it to another sink.
+ */
+class TranscodeXmlSink : public AbstractXmlOutputSink {
+public:
+    DLLLOCAL TranscodeXmlSink(AbstractXmlOutputSink& out, const QoreEncoding* enc) : out(out), buf(enc) {
+    }
+
+    //! @returns 0 = OK, -1 = error (exception raised)
+    DLLLOCAL int init(ExceptionSink* xsink) {
+        return t.init(xsink, buf.getEncoding());
+    }
+
+    DLLLOCAL virtual int write(const char* data, size_t len, ExceptionSink* xsink) {
+        buf.clear();
+        if (t.convert(xsink, data, len, buf))
+            return -1;
+        return buf.empty() ? 0 : out.write(buf.c_str(), buf.size(), xsink);
+    }
+
+    DLLLOCAL virtual int finish(ExceptionSink* xsink) {
+        buf.clear();
+        if (t.finish(xsink, buf) || (!buf.empty() && out.write(buf.c_str(), buf.size(), xsink)))
+            return -1;
+        return out.finish(xsink);
+    }
+
+private:
+    AbstractXmlOutputSink& out;
+    XmlTranscoder t;
+    //! converted data in the document encoding
+    QoreString buf;
+};
+
+#endif
@@ -31,17 +31,54 @@
 
 #include <qore/Qore.h>
 
+#include <memory>
+
 class MakeXmlOpts;
+class AbstractXmlOutputSink;
+class CompressXmlSink;
+class TranscodeXmlSink;
 
 DLLLOCAL void init_xml_constants(QoreNamespace& ns);
 
 DLLLOCAL QoreStringNode* make_xml(ExceptionSink* xsink, const QoreHashNode &h, const MakeXmlOpts &opts);
+// builds a document tree directly from the hash; returns nullptr if an exception was raised or if the document has to
+// be built by parsing the output of make_xml() (no exception raised in this case)
+DLLLOCAL xmlDocPtr make_xml_doc(ExceptionSink* xsink, const QoreHashNode &h, const MakeXmlOpts &opts);
+// serializes a complete XML document to the sink in blocks; returns 0 = OK, -1 = error
+DLLLOCAL int make_xml(ExceptionSink* xsink, AbstractXmlOutputSink &sink, const QoreHashNode &h, const MakeXmlOpts &opts);
 DLLLOCAL QoreStringNode* make_xmlrpc_call(ExceptionSink* xsink, const QoreEncoding* ccs, int offset, const QoreListNode* args, int flags = 0);
 DLLLOCAL QoreStringNode* make_xmlrpc_call_args(ExceptionSink* xsink, const QoreEncoding* ccs, int offset, const QoreListNode* args, int flags = 0);
 // ccsid is the output encoding for strings
 DLLLOCAL QoreHashNode* parse_xmlrpc_response(ExceptionSink* xsink, const QoreString* msg, const QoreEncoding* ccsid, int flags = 0);
 DLLLOCAL void init_xml_functions(QoreNamespace& ns);
 
+class MakeXmlOutput;
+
+// minimum number of list entries for parallel serialization with the "parallel" option
+#define MAKE_XML_PARALLEL_MIN_SIZE 1024
+// number of list entries serialized by a worker thread at a time
+#define MAKE_XML_PARALLEL_CHUNK_SIZE 256
+
+// returns true if the hash has a single top-level key as required for a complete XML document
+DLLLOCAL bool hash_ok(const QoreHashNode* h);
+// writes the XML header for a complete document
+DLLLOCAL void make_xml_header(QoreString &str, const MakeXmlOpts &opts);
+// serializes a hash value as an XML element with the given tag name; check xsink for errors
+DLLLOCAL void add_xml_element(ExceptionSink* xsink, const char* key, size_t key_len, MakeXmlOutput &out,
+        const QoreValue n, int indent, const MakeXmlOpts &opts);
+// appends a value that is not a hash or list as XML text; returns 0 = OK, -1 = error
+DLLLOCAL int concat_simple_value(ExceptionSink* xsink, QoreString &str, const QoreValue n, const MakeXmlOpts &opts);
+// appends an attribute value without the quotes; returns 0 = OK, -1 = error
+DLLLOCAL int concat_xml_attribute_value(ExceptionSink* xsink, QoreString &str, const QoreValue v,
+        const MakeXmlOpts &opts);
+// appends all attributes in the hash as name="value" pairs; returns 0 = OK, -1 = error
+DLLLOCAL int concat_xml_attributes(ExceptionSink* xsink, QoreString &str, const QoreHashNode &ah,
+        const MakeXmlOpts &opts);
+
+// appends the string to the XML output with special characters escaped; same output as QoreString::concatEncode()
+// with CE_XML and CE_NONASCII if numeric_refs is true; returns 0 = OK, -1 = error
+DLLLOCAL int concat_xml_escaped(ExceptionSink* xsink, QoreString& str, const QoreString& src, bool numeric_refs);
+
 // returns the string corresponding to the element type
 DLLLOCAL const char* get_xml_element_type_name(int t);
 
@@ -79,8 +116,86 @@ public:
         return xmlSchemaValidateDoc(ctx, doc);
     }
 };
+
+/**
+ * Validates XML against an XSD schema while it's generated.
+ *
+ * The XML is fed in blocks to a push parser with an empty SAX2 handler and
+ * the schema validator plugged in with xmlSchemaSAXPlug(), so no document
+ * tree or Qore data is built for validation.
+ */
+class QoreXmlSchemaPushValidator {
+public:
+    DLLLOCAL QoreXmlSchemaPushValidator(const QoreString& xsd, ExceptionSink* xsink);
+
+    DLLLOCAL ~QoreXmlSchemaPushValidator();
+
+    DLLLOCAL operator bool() const {
+        return pctx != nullptr;
+    }
+
+    /**
+     * Validates the next block of XML data.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int push(ExceptionSink* xsink, const char* data, size_t len);
+
+    /**
+     * Validates the end of the document; must be called after the last block.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int finish(ExceptionSink* xsink);
+
+private:
+    QoreXmlSchemaContext schema;
+    //! the empty SAX2 handler wrapped by the validator
+    xmlSAXHandler sax;
+    xmlSchemaSAXPlugPtr plug = nullptr;
+    xmlParserCtxtPtr pctx = nullptr;
+
+    DLLLOCAL int check(ExceptionSink* xsink, int rc);
+};
 #endif
 
+/**
+ * The sinks that serialized XML blocks pass through before they reach the
+ * destination sink: transcoding, validation with the "xsd" option and
+ * compression with the "compress" option.
+ */
+class MakeXmlSinkChain {
+public:
+    DLLLOCAL MakeXmlSinkChain();
+
+    DLLLOCAL ~MakeXmlSinkChain();
+
+    /**
+     * Creates the sinks for the options in front of \a sink.
+     *
+     * If \a transcode is false, the blocks must already be in the output
+     * encoding.
+     * @returns 0 = OK, -1 = error (exception raised)
+     */
+    DLLLOCAL int init(ExceptionSink* xsink, AbstractXmlOutputSink& sink, const MakeXmlOpts& opts,
+            bool transcode = true);
+
+    //! returns the sink that serialized blocks are written to
+    DLLLOCAL AbstractXmlOutputSink* get() const {
+        return head;
+    }
+
+    //! returns the encoding that blocks must be serialized in
+    DLLLOCAL const QoreEncoding* getEncoding() const {
+        return enc;
+    }
+
+private:
+    std::unique_ptr<CompressXmlSink> csink;
+    std::unique_ptr<AbstractXmlOutputSink> vsink;
+    std::unique_ptr<TranscodeXmlSink> tsink;
+    AbstractXmlOutputSink* head = nullptr;
+    const QoreEncoding* enc = nullptr;
+};
+
 #ifdef HAVE_XMLTEXTREADERRELAXNGSETSCHEMA
 class QoreXmlRelaxNGContext {
    friend class QoreXmlRelaxNGValidContext;
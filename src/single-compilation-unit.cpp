@@ -5,6 +5,8 @@
 #include "QC_SaxIterator.cpp"
 #include "QC_FileSaxIterator.cpp"
 #include "QC_InputStreamSaxIterator.cpp"
+#include "QC_XmlSerializerTemplate.cpp"
+#include "QC_XmlWriter.cpp"
 #include "ql_xml.cpp"
 #include "qc_option.cpp"
 #include "xml-module.cpp"
@@ -12,3 +14,10 @@
 #include "QoreXmlRpcReader.cpp"
 #include "MakeXmlOpts.cpp"
 #include "QC_AbstractXmlIoInputCallback.cpp"
+#include "XmlEscape.cpp"
+#include "XmlCompress.cpp"
+#include "XmlTranscode.cpp"
+#include "QoreXmlDataBuilder.cpp"
+#include "XmlMappedFile.cpp"
+#include "XmlRecordParser.cpp"
+#include "XmlThreadPool.cpp"
@@ -26,9 +26,12 @@
 #include "QC_XmlNode.h"
 #include "QC_XmlReader.h"
 #include "QC_SaxIterator.h"
+#include "QC_XmlSerializerTemplate.h"
+#include "QC_XmlWriter.h"
 #include "QC_AbstractXmlIoInputCallback.h"
 
 #include "ql_xml.h"
+#include "XmlThreadPool.h"
 
 #include <libxml/xmlversion.h>
 
@@ -125,6 +128,8 @@ QoreStringNode* xml_module_init() {
     XNS.addSystemClass(initFileSaxIteratorClass(XNS));
     XNS.addSystemClass(initInputStreamSaxIteratorClass(XNS));
     XNS.addSystemClass(initAbstractXmlIoInputCallbackClass(XNS));
+    XNS.addSystemClass(initXmlSerializerTemplateClass(XNS));
+    XNS.addSystemClass(initXmlWriterClass(XNS));
 
     XNS.addSystemClass(initXmlRpcClientClass(XNS));
 
@@ -147,6 +152,7 @@ void xml_module_ns_init(QoreNamespace *rns, QoreNamespace *qns) {
 }
 
 void xml_module_delete() {
+   xml_thread_pool.shutdown();
    // cleanup libxml2 library
    xmlCleanupParser();
 }
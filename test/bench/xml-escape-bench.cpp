@@ -0,0 +1,146 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    xml-escape-bench.cpp
+
+    microbenchmark for the XML escaping kernel in src/XmlEscape.cpp
+
+    build with:
+        cmake --build <build-dir> --target xml-escape-bench
+    or:
+        g++ -O2 -I src test/bench/xml-escape-bench.cpp src/XmlEscape.cpp -o xml-escape-bench
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlEscape.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// the byte-at-a-time escaping loop used before the kernel was introduced
+static void escape_bytewise(std::string& out, const std::string& in, bool numeric_refs) {
+    const unsigned char* p = (const unsigned char*)in.data();
+    size_t len = in.size();
+    char buf[16];
+    while (len) {
+        size_t elen;
+        const char* entity = xml_escape_get_entity(*p, elen);
+        if (entity) {
+            out.append(entity, elen);
+        } else if (numeric_refs && *p >= 0x80) {
+            unsigned cp = 0;
+            size_t clen = xml_escape_decode_utf8(p, len, cp);
+            out.append(buf, snprintf(buf, sizeof buf, "&#%u;", cp));
+            p += clen;
+            len -= clen;
+            continue;
+        } else {
+            out += (char)*p;
+        }
+        ++p;
+        --len;
+    }
+}
+
+// the kernel-based loop used by concat_xml_escaped()
+static void escape_kernel(std::string& out, const std::string& in, bool numeric_refs) {
+    const char* p = in.data();
+    size_t len = in.size();
+    char buf[16];
+    while (len) {
+        size_t n = xml_escape_scan(p, len, numeric_refs);
+        out.append(p, n);
+        p += n;
+        len -= n;
+        if (!len)
+            break;
+        size_t elen;
+        const char* entity = xml_escape_get_entity((unsigned char)*p, elen);
+        if (entity) {
+            out.append(entity, elen);
+            ++p;
+            --len;
+            continue;
+        }
+        unsigned cp = 0;
+        size_t clen = xml_escape_decode_utf8((const unsigned char*)p, len, cp);
+        out.append(buf, snprintf(buf, sizeof buf, "&#%u;", cp));
+        p += clen;
+        len -= clen;
+    }
+}
+
+// creates a test string of the given size with one special character every "every" bytes (0 = none)
+static std::string make_input(size_t size, size_t every, const char* special) {
+    static const char text[] = "The quick brown fox jumps over the lazy dog 0123456789 ";
+    std::string rv;
+    rv.reserve(size + 8);
+    size_t i = 0;
+    while (rv.size() < size) {
+        if (every && i && !(i % every))
+            rv += special;
+        else
+            rv += text[i % (sizeof text - 1)];
+        ++i;
+    }
+    return rv;
+}
+
+typedef void (*escape_func_t)(std::string& out, const std::string& in, bool numeric_refs);
+
+static double run(escape_func_t f, const std::string& in, bool numeric_refs, int iters, std::string& out) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) {
+        out.clear();
+        f(out, in, numeric_refs);
+    }
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return (double)in.size() * iters / d.count() / (1024 * 1024);
+}
+
+int main(int argc, char* argv[]) {
+    int iters = argc > 1 ? atoi(argv[1]) : 200;
+    struct {
+        const char* name;
+        size_t every;
+        const char* special;
+        bool numeric_refs;
+    } cases[] = {
+        {"plain ASCII", 0, "", false},
+        {"1 special / 64 bytes", 64, "&", false},
+        {"1 special / 8 bytes", 8, "<", false},
+        {"non-ASCII / 32 bytes, numeric refs", 32, "\xc3\xa9", true},
+    };
+
+    printf("kernel: %s\n", xml_escape_scan_kernel());
+    printf("%-36s %12s %12s %8s\n", "case", "byte MB/s", "kernel MB/s", "speedup");
+    int rc = 0;
+    for (auto& c : cases) {
+        std::string in = make_input(1024 * 1024, c.every, c.special);
+        std::string ref, out;
+        double ref_rate = run(escape_bytewise, in, c.numeric_refs, iters, ref);
+        double rate = run(escape_kernel, in, c.numeric_refs, iters, out);
+        if (ref != out) {
+            fprintf(stderr, "ERROR: output mismatch for case \"%s\"\n", c.name);
+            rc = 1;
+        }
+        printf("%-36s %12.1f %12.1f %7.2fx\n", c.name, ref_rate, rate, rate / ref_rate);
+    }
+    return rc;
+}
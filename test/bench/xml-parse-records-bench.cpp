@@ -0,0 +1,227 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    xml-parse-records-bench.cpp
+
+    parse benchmark for parse_xml_records() and parse_xml_file_records(): parses a document with many record
+    elements as one document, in chunks of records found with src/XmlRecordScanner.h, and in chunks with several
+    threads
+
+    build with:
+        cmake --build <build-dir> --target xml-parse-records-bench
+    or:
+        g++ -O2 -std=c++11 -pthread -I src -I /usr/include/libxml2 test/bench/xml-parse-records-bench.cpp -lxml2 \
+            -o xml-parse-records-bench
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlSaxParser.h"
+#include "XmlRecordScanner.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the options used by parse_xml()
+#define BENCH_PARSER_OPTIONS (XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_NOBLANKS | XML_PARSE_HUGE)
+
+// the chunk size used by XmlRecordParser
+#define BENCH_CHUNK_SIZE (1024 * 1024)
+
+// accumulates a checksum of the nodes received below the root element
+struct checksum_handler {
+    size_t sum = 0;
+    int last_depth = 0;
+
+    int element(const char* name, int depth) {
+        last_depth = depth;
+        if (depth)
+            sum += strlen(name) + depth;
+        return 0;
+    }
+
+    bool skipSubtree() const {
+        return false;
+    }
+
+    int attribute(const char* name, const char* value, size_t len) {
+        if (last_depth)
+            sum += strlen(name) + len;
+        return 0;
+    }
+
+    int endAttributes() {
+        if (last_depth)
+            ++sum;
+        return 0;
+    }
+
+    int text(const char* str, size_t len, int depth) {
+        sum += len + depth;
+        return 0;
+    }
+
+    int cdata(const char* str, size_t len, int depth) {
+        sum += len + depth;
+        return 0;
+    }
+
+    int comment(const char* str, size_t len, int depth) {
+        return 0;
+    }
+};
+
+static size_t parse_doc(const char* buf, size_t len, XmlSaxParserContext* ctxt = nullptr) {
+    checksum_handler h;
+    XmlSaxParser<checksum_handler> parser(h, false);
+    return parser.parse(buf, len, BENCH_PARSER_OPTIONS, nullptr, ctxt) ? 0 : h.sum;
+}
+
+// parses a chunk of records like XmlRecordParser::parseChunk()
+static size_t parse_chunk(const std::string& xml, const XmlRecordScanner& scanner, const XmlRecordChunk& chunk,
+        std::string& doc, XmlSaxParserContext& ctxt) {
+    doc.assign(xml.data(), scanner.getRootEnd());
+    for (auto& i : chunk.ranges)
+        doc.append(xml.data() + i.first, i.second - i.first);
+    doc.append("</");
+    doc.append(scanner.getRootName());
+    doc.append(">");
+    return parse_doc(doc.data(), doc.size(), &ctxt);
+}
+
+static size_t parse_whole(const std::string& xml, int threads) {
+    return parse_doc(xml.data(), xml.size());
+}
+
+static size_t scan_only(const std::string& xml, int threads) {
+    XmlRecordScanner scanner(xml.data(), xml.size(), "record");
+    if (scanner.init())
+        return 0;
+    XmlRecordChunk chunk;
+    size_t count = 0;
+    while (scanner.next(chunk, BENCH_CHUNK_SIZE))
+        count += chunk.count;
+    return count;
+}
+
+static size_t parse_records(const std::string& xml, int threads) {
+    XmlRecordScanner scanner(xml.data(), xml.size(), "record");
+    if (scanner.init())
+        return 0;
+
+    std::mutex m;
+    std::atomic<size_t> sum(0);
+    auto work = [&]() {
+        XmlRecordChunk chunk;
+        std::string doc;
+        XmlSaxParserContext ctxt;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> l(m);
+                if (!scanner.next(chunk, BENCH_CHUNK_SIZE))
+                    break;
+            }
+            sum += parse_chunk(xml, scanner, chunk, doc, ctxt);
+        }
+    };
+
+    if (threads < 2) {
+        work();
+    } else {
+        std::vector<std::thread> tv;
+        for (int i = 0; i < threads; ++i)
+            tv.push_back(std::thread(work));
+        for (auto& t : tv)
+            t.join();
+    }
+    return scanner.truncated() ? 0 : sum.load();
+}
+
+template <typename F>
+static void run(const char* name, F f, const std::string& xml, int threads, int iters, size_t& sum) {
+    auto start = std::chrono::steady_clock::now();
+    sum = 0;
+    for (int i = 0; i < iters; ++i)
+        sum += f(xml, threads);
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    double ms = d.count() * 1000 / iters;
+    printf("  %-12s %8d %14.3f %14.1f\n", name, threads, ms, xml.size() / (ms * 1000));
+}
+
+// a formatted document with "count" records with attributes and "fields" child elements each
+static std::string make_records(int count, int fields) {
+    std::string rv = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!-- records -->\n"
+        "<r:records xmlns:r=\"urn:records\" version=\"1\">\n";
+    for (int c = 0; c < count; ++c) {
+        if (c && !(c % 1000))
+            rv += "  <!-- " + std::to_string(c) + " -->\n";
+        rv += "  <r:record id=\"" + std::to_string(c) + "\" type=\"a>b\">\n";
+        for (int f = 0; f < fields; ++f) {
+            rv += "    <field" + std::to_string(f) + ">value " + std::to_string(c * fields + f)
+                + " &amp; more</field" + std::to_string(f) + ">\n";
+        }
+        rv += "    <note><![CDATA[note </r:record> " + std::to_string(c) + "]]></note>\n    <empty/>\n"
+            "  </r:record>\n";
+    }
+    rv += "</r:records>\n";
+    return rv;
+}
+
+int main(int argc, char* argv[]) {
+    int iters = argc > 1 ? atoi(argv[1]) : 5;
+    int max_threads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    xmlInitParser();
+
+    struct {
+        const char* name;
+        std::string xml;
+        int count;
+    } cases[2];
+    cases[0].name = "records: 200000 records x 10 fields";
+    cases[0].xml = make_records(200000, 10);
+    cases[0].count = 200000;
+    cases[1].name = "records: 20000 records x 100 fields";
+    cases[1].xml = make_records(20000, 100);
+    cases[1].count = 20000;
+
+    int rc = 0;
+    for (auto& c : cases) {
+        printf("%s (%.1f MB)\n", c.name, c.xml.size() / 1000000.0);
+        printf("  %-12s %8s %14s %14s\n", "parser", "threads", "ms/parse", "MB/s");
+        size_t whole_sum, scan_count, sum;
+        run("whole", parse_whole, c.xml, 1, iters, whole_sum);
+        run("scan", scan_only, c.xml, 1, iters, scan_count);
+        if (scan_count != (size_t)c.count * iters) {
+            fprintf(stderr, "ERROR: record count mismatch for case \"%s\"\n", c.name);
+            rc = 1;
+        }
+        for (int t = 1; t <= max_threads; t *= 2) {
+            run("records", parse_records, c.xml, t, iters, sum);
+            if (!whole_sum || sum != whole_sum) {
+                fprintf(stderr, "ERROR: checksum mismatch for case \"%s\" with %d threads\n", c.name, t);
+                rc = 1;
+            }
+        }
+    }
+    xmlCleanupParser();
+    return rc;
+}
@@ -0,0 +1,176 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    xml-parse-sax-bench.cpp
+
+    parse benchmark for the SAX2 parser used by parse_xml() in src/XmlSaxParser.h compared to reading the document
+    with xmlTextReader
+
+    build with:
+        cmake --build <build-dir> --target xml-parse-sax-bench
+    or:
+        g++ -O2 -std=c++11 -I src -I /usr/include/libxml2 test/bench/xml-parse-sax-bench.cpp -lxml2 \
+            -o xml-parse-sax-bench
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlSaxParser.h"
+
+#include <libxml/xmlreader.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// the options used by parse_xml()
+#define BENCH_PARSER_OPTIONS (XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_NOBLANKS | XML_PARSE_HUGE)
+
+// accumulates a checksum of the nodes received
+struct checksum_handler {
+    size_t sum = 0;
+
+    int element(const char* name, int depth) {
+        sum += strlen(name) + depth;
+        return 0;
+    }
+
+    bool skipSubtree() const {
+        return false;
+    }
+
+    int attribute(const char* name, const char* value, size_t len) {
+        sum += strlen(name) + len;
+        return 0;
+    }
+
+    int endAttributes() {
+        ++sum;
+        return 0;
+    }
+
+    int text(const char* str, size_t len, int depth) {
+        sum += len + depth;
+        return 0;
+    }
+
+    int cdata(const char* str, size_t len, int depth) {
+        sum += len + depth;
+        return 0;
+    }
+
+    int comment(const char* str, size_t len, int depth) {
+        return 0;
+    }
+};
+
+// reads the document like QoreXmlReader::getXmlData()
+static size_t parse_reader(const std::string& xml) {
+    checksum_handler h;
+    xmlTextReaderPtr reader = xmlReaderForDoc((const xmlChar*)xml.c_str(), nullptr, nullptr, BENCH_PARSER_OPTIONS);
+    int rc = xmlTextReaderRead(reader);
+    while (rc == 1) {
+        int nt = xmlTextReaderNodeType(reader);
+        if (nt == XML_READER_TYPE_SIGNIFICANT_WHITESPACE) {
+            rc = xmlTextReaderRead(reader);
+            continue;
+        }
+        const char* name = (const char*)xmlTextReaderConstName(reader);
+        int depth = xmlTextReaderDepth(reader);
+        if (nt == XML_READER_TYPE_ELEMENT) {
+            h.element(name, depth);
+            if (xmlTextReaderHasAttributes(reader) == 1) {
+                while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+                    const char* value = (const char*)xmlTextReaderConstValue(reader);
+                    h.attribute((const char*)xmlTextReaderConstName(reader), value, strlen(value));
+                }
+                h.endAttributes();
+            }
+        } else if (nt == XML_READER_TYPE_TEXT) {
+            const char* str = (const char*)xmlTextReaderConstValue(reader);
+            h.text(str, strlen(str), depth);
+        } else if (nt == XML_READER_TYPE_CDATA) {
+            const char* str = (const char*)xmlTextReaderConstValue(reader);
+            h.cdata(str, strlen(str), depth);
+        }
+        rc = xmlTextReaderRead(reader);
+    }
+    xmlFreeTextReader(reader);
+    return rc ? 0 : h.sum;
+}
+
+static size_t parse_sax(const std::string& xml) {
+    checksum_handler h;
+    XmlSaxParser<checksum_handler> parser(h, false);
+    return parser.parse(xml.data(), xml.size(), BENCH_PARSER_OPTIONS) ? 0 : h.sum;
+}
+
+template <typename F>
+static void run(const char* name, F f, const std::string& xml, int iters, size_t& sum) {
+    auto start = std::chrono::steady_clock::now();
+    sum = 0;
+    for (int i = 0; i < iters; ++i)
+        sum += f(xml);
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    double ms = d.count() * 1000 / iters;
+    printf("  %-8s %14.3f %14.1f\n", name, ms, xml.size() / (ms * 1000));
+}
+
+// a formatted document with "count" records with attributes and "fields" child elements each
+static std::string make_records(int count, int fields) {
+    std::string rv = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<soap:Envelope "
+        "xmlns:soap=\"http://schemas.xmlsoap.org/soap/envelope/\">\n  <soap:Body>\n    <records>\n";
+    for (int c = 0; c < count; ++c) {
+        rv += "      <record id=\"" + std::to_string(c) + "\" type=\"item\">\n";
+        for (int f = 0; f < fields; ++f) {
+            rv += "        <field" + std::to_string(f) + ">value " + std::to_string(c * fields + f) + " &amp; more</field"
+                + std::to_string(f) + ">\n";
+        }
+        rv += "        <note><![CDATA[note " + std::to_string(c) + "]]></note>\n      </record>\n";
+    }
+    rv += "    </records>\n  </soap:Body>\n</soap:Envelope>\n";
+    return rv;
+}
+
+int main(int argc, char* argv[]) {
+    int iters = argc > 1 ? atoi(argv[1]) : 10;
+    xmlInitParser();
+
+    struct {
+        const char* name;
+        std::string xml;
+    } cases[2];
+    cases[0].name = "records: 20000 records x 10 fields";
+    cases[0].xml = make_records(20000, 10);
+    cases[1].name = "records: 2000 records x 100 fields";
+    cases[1].xml = make_records(2000, 100);
+
+    int rc = 0;
+    for (auto& c : cases) {
+        printf("%s (%.1f MB)\n", c.name, c.xml.size() / 1000000.0);
+        printf("  %-8s %14s %14s\n", "parser", "ms/parse", "MB/s");
+        size_t reader_sum, sax_sum;
+        run("reader", parse_reader, c.xml, iters, reader_sum);
+        run("sax", parse_sax, c.xml, iters, sax_sum);
+        if (!reader_sum || reader_sum != sax_sum) {
+            fprintf(stderr, "ERROR: checksum mismatch for case \"%s\"\n", c.name);
+            rc = 1;
+        }
+    }
+    xmlCleanupParser();
+    return rc;
+}
@@ -0,0 +1,229 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    xml-parse-stack-bench.cpp
+
+    parse benchmark for the element stack used by parse_xml() in src/XmlElementStack.h
+
+    build with:
+        cmake --build <build-dir> --target xml-parse-stack-bench
+    or:
+        g++ -O2 -std=c++11 -I src -I /usr/include/libxml2 test/bench/xml-parse-stack-bench.cpp -lxml2 \
+            -o xml-parse-stack-bench
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlElementStack.h"
+
+#include <libxml/xmlreader.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// counts allocations made with operator new; libxml2 allocates with malloc() and is not counted
+static size_t new_count = 0;
+
+void* operator new(size_t size) {
+    ++new_count;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// the linked-list stack used before XmlElementStack was introduced
+class legacy_stack {
+public:
+    legacy_stack(int& base) {
+        push(base, -1);
+    }
+
+    ~legacy_stack() {
+        while (tail) {
+            node* n = tail->next;
+            delete tail;
+            tail = n;
+        }
+    }
+
+    void checkDepth(int depth) {
+        while (tail && depth && tail->depth >= depth) {
+            node* n = tail->next;
+            delete tail;
+            tail = n;
+        }
+    }
+
+    void push(int& v, int depth) {
+        node* n = new node(v, depth);
+        n->next = tail;
+        tail = n;
+    }
+
+    int& top() {
+        return tail->v;
+    }
+
+private:
+    struct node {
+        int& v;
+        node* next = nullptr;
+        int depth;
+        int vcount = 0;
+        int cdcount = 0;
+        int commentcount = 0;
+
+        node(int& v, int depth) : v(v), depth(depth) {
+        }
+    };
+
+    node* tail = nullptr;
+};
+
+class vector_stack {
+public:
+    vector_stack(int& base) {
+        stack.push(base, -1);
+    }
+
+    void checkDepth(int depth) {
+        stack.checkDepth(depth);
+    }
+
+    void push(int& v, int depth) {
+        stack.push(v, depth);
+    }
+
+    int& top() {
+        return *stack.top().node;
+    }
+
+private:
+    XmlElementStack<int> stack;
+};
+
+// parses the document, maintaining the stack for each element like QoreXmlReader::getXmlData(); returns a checksum
+template <typename S>
+static long parse(const std::string& xml, std::vector<int>& slots) {
+    xmlTextReaderPtr reader = xmlReaderForMemory(xml.data(), (int)xml.size(), nullptr, nullptr, 0);
+    int base = 0;
+    S stack(base);
+    size_t n = 0;
+    long sum = 0;
+    while (xmlTextReaderRead(reader) == 1) {
+        int nt = xmlTextReaderNodeType(reader);
+        int depth = xmlTextReaderDepth(reader);
+        if (nt == XML_READER_TYPE_ELEMENT) {
+            stack.checkDepth(depth);
+            ++stack.top();
+            slots[n] = 0;
+            stack.push(slots[n++], depth);
+            // empty elements are popped by the next element at the same depth
+        } else if (nt == XML_READER_TYPE_TEXT) {
+            stack.checkDepth(depth);
+            sum += stack.top();
+        }
+    }
+    xmlFreeTextReader(reader);
+    return sum + base;
+}
+
+template <typename S>
+static void run(const char* name, const std::string& xml, size_t elements, int iters, long& sum) {
+    std::vector<int> slots(elements);
+    // the first parse on the thread allocates the vector kept for later parses
+    parse<S>(xml, slots);
+
+    size_t start_count = new_count;
+    auto start = std::chrono::steady_clock::now();
+    sum = 0;
+    for (int i = 0; i < iters; ++i)
+        sum += parse<S>(xml, slots);
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    printf("  %-8s %14.1f %14.3f\n", name, (double)(new_count - start_count) / iters, d.count() * 1000 / iters);
+}
+
+// a document with elements nested to the given depth, repeated "count" times
+static std::string make_deep(int depth, int count, size_t& elements) {
+    std::string rv = "<root>";
+    for (int c = 0; c < count; ++c) {
+        for (int i = 0; i < depth; ++i)
+            rv += "<e>";
+        rv += "x";
+        for (int i = 0; i < depth; ++i)
+            rv += "</e>";
+    }
+    rv += "</root>";
+    elements = (size_t)depth * count + 1;
+    return rv;
+}
+
+// a document with "count" records with "fields" child elements each
+static std::string make_wide(int count, int fields, size_t& elements) {
+    std::string rv = "<root>";
+    for (int c = 0; c < count; ++c) {
+        rv += "<record>";
+        for (int f = 0; f < fields; ++f)
+            rv += "<f" + std::to_string(f) + ">" + std::to_string(c) + "</f" + std::to_string(f) + ">";
+        rv += "</record>";
+    }
+    rv += "</root>";
+    elements = (size_t)count * (fields + 1) + 1;
+    return rv;
+}
+
+int main(int argc, char* argv[]) {
+    int iters = argc > 1 ? atoi(argv[1]) : 20;
+    xmlInitParser();
+
+    struct {
+        const char* name;
+        std::string xml;
+        size_t elements;
+    } cases[2];
+    cases[0].name = "deep: 500 x depth 200";
+    cases[0].xml = make_deep(200, 500, cases[0].elements);
+    cases[1].name = "wide: 20000 records x 10 fields";
+    cases[1].xml = make_wide(20000, 10, cases[1].elements);
+
+    int rc = 0;
+    for (auto& c : cases) {
+        printf("%s (%zu elements)\n", c.name, c.elements);
+        printf("  %-8s %14s %14s\n", "stack", "allocs/parse", "ms/parse");
+        long legacy_sum, vector_sum;
+        run<legacy_stack>("list", c.xml, c.elements, iters, legacy_sum);
+        run<vector_stack>("vector", c.xml, c.elements, iters, vector_sum);
+        if (legacy_sum != vector_sum) {
+            fprintf(stderr, "ERROR: checksum mismatch for case \"%s\"\n", c.name);
+            rc = 1;
+        }
+    }
+    xmlCleanupParser();
+    return rc;
+}
@@ -0,0 +1,192 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    xml-parse-suffix-bench.cpp
+
+    parse benchmark for the duplicate key suffixes assigned by parse_xml() with XPF_PRESERVE_ORDER when element
+    names repeat non-adjacently
+
+    build with:
+        cmake --build <build-dir> --target xml-parse-suffix-bench
+    or:
+        g++ -O2 -std=c++11 -I src -I /usr/include/libxml2 test/bench/xml-parse-suffix-bench.cpp -lxml2 \
+            -o xml-parse-suffix-bench
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "XmlElementStack.h"
+
+#include <libxml/xmlreader.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// the keys of a hash created while parsing
+struct hash {
+    std::unordered_set<std::string> keys;
+    std::string last;
+};
+
+// from QoreXmlReader.cpp
+static bool keys_are_equal(const char* k1, const char* k2, bool &get_value) {
+    while (true) {
+        if (!(*k1)) {
+            if (!(*k2))
+                return true;
+            if ((*k2) == '^') {
+                get_value = true;
+                return true;
+            }
+            return false;
+        }
+        if ((*k1) != (*k2))
+            break;
+        k1++;
+        k2++;
+    }
+    return false;
+}
+
+// probes "name^1", "name^2", ... until a free key is found, as before the suffix counters were introduced
+struct probe_suffix {
+    static std::string get(XmlElementStack<int>&, const hash& h, const char* name) {
+        char buf[256];
+        int c = 1;
+        while (true) {
+            snprintf(buf, sizeof buf, "%s^%d", name, c);
+            if (!h.keys.count(buf))
+                return buf;
+            ++c;
+        }
+    }
+};
+
+// uses the suffix counters of the element stack
+struct counter_suffix {
+    static std::string get(XmlElementStack<int>& stack, const hash&, const char* name) {
+        char buf[256];
+        snprintf(buf, sizeof buf, "%s^%d", name, stack.nextSuffix(name));
+        return buf;
+    }
+};
+
+// parses the document, assigning hash keys like QoreXmlReader::getXmlData() with XPF_PRESERVE_ORDER; returns a
+// checksum of the keys created
+template <typename S>
+static size_t parse(const std::string& xml, std::vector<int>& slots, std::vector<hash>& hashes) {
+    hashes.clear();
+    xmlTextReaderPtr reader = xmlReaderForMemory(xml.data(), (int)xml.size(), nullptr, nullptr, 0);
+    int base = -1;
+    XmlElementStack<int> stack;
+    stack.push(base, -1);
+    size_t n = 0;
+    size_t sum = 0;
+    while (xmlTextReaderRead(reader) == 1) {
+        if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT)
+            continue;
+        int depth = xmlTextReaderDepth(reader);
+        stack.checkDepth(depth);
+        const char* name = (const char*)xmlTextReaderConstName(reader);
+
+        int& parent = *stack.top().node;
+        if (parent < 0) {
+            parent = (int)hashes.size();
+            hashes.emplace_back();
+        }
+        hash& h = hashes[parent];
+        std::string key;
+        bool get_value = false;
+        if (!h.keys.count(name))
+            key = name;
+        else if (!keys_are_equal(name, h.last.c_str(), get_value))
+            key = S::get(stack, h, name);
+        // otherwise the element is added to the list under the last key
+        if (!key.empty()) {
+            sum += key.size();
+            h.keys.insert(key);
+            h.last = std::move(key);
+        }
+
+        slots[n] = -1;
+        stack.push(slots[n++], depth);
+        // empty elements are popped by the next element at the same depth
+    }
+    xmlFreeTextReader(reader);
+    return sum;
+}
+
+template <typename S>
+static void run(const char* name, const std::string& xml, size_t elements, int iters, size_t& sum) {
+    std::vector<int> slots(elements);
+    std::vector<hash> hashes;
+    auto start = std::chrono::steady_clock::now();
+    sum = 0;
+    for (int i = 0; i < iters; ++i)
+        sum += parse<S>(xml, slots, hashes);
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    printf("  %-8s %14.3f\n", name, d.count() * 1000 / iters);
+}
+
+// a document with "count" records with "fields" child elements each, where two element names alternate
+static std::string make_interleaved(int count, int fields, size_t& elements) {
+    std::string rv = "<root>";
+    for (int c = 0; c < count; ++c) {
+        rv += "<record>";
+        for (int f = 0; f < fields; ++f)
+            rv += (f & 1) ? "<note>n</note>" : "<item>i</item>";
+        rv += "</record>";
+    }
+    rv += "</root>";
+    elements = (size_t)count * (fields + 1) + 1;
+    return rv;
+}
+
+int main(int argc, char* argv[]) {
+    int iters = argc > 1 ? atoi(argv[1]) : 1;
+    xmlInitParser();
+
+    struct {
+        const char* name;
+        std::string xml;
+        size_t elements;
+    } cases[3];
+    cases[0].name = "records: 1000 records x 100 interleaved elements";
+    cases[0].xml = make_interleaved(1000, 100, cases[0].elements);
+    cases[1].name = "records: 100 records x 1000 interleaved elements";
+    cases[1].xml = make_interleaved(100, 1000, cases[1].elements);
+    cases[2].name = "flat: 1 record x 20000 interleaved elements";
+    cases[2].xml = make_interleaved(1, 20000, cases[2].elements);
+
+    int rc = 0;
+    for (auto& c : cases) {
+        printf("%s (%zu elements)\n", c.name, c.elements);
+        printf("  %-8s %14s\n", "suffix", "ms/parse");
+        size_t probe_sum, counter_sum;
+        run<probe_suffix>("probe", c.xml, c.elements, iters, probe_sum);
+        run<counter_suffix>("counter", c.xml, c.elements, iters, counter_sum);
+        if (probe_sum != counter_sum) {
+            fprintf(stderr, "ERROR: checksum mismatch for case \"%s\"\n", c.name);
+            rc = 1;
+        }
+    }
+    xmlCleanupParser();
+    return rc;
+}
@@ -0,0 +1,224 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+    xml-parse-transcode-bench.cpp
+
+    parse benchmark for the SAX2 parser used by parse_xml() in src/XmlSaxParser.h compared to reading the document
+    with xmlTextReader
+
+    build with:
+        cmake --build <build-dir> --target xml-parse-sax-bench
+    or:
+        g++ -O2 -std=c++11 -I src -I /usr/include/libxml2 test/bench/xml-parse-transcode-bench.cpp -lxml2 \
+            -o xml-parse-sax-bench
+
+    Copyright (C) 2022 Qore Technologies, s.r.o.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "XmlSaxParser.h"
+
+#include <iconv.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// the options used by parse_xml()
+#define BENCH_PARSER_OPTIONS (XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_NOBLANKS | XML_PARSE_HUGE)
+
+// the encoding of the document and of the output strings
+#define BENCH_ENCODING "ISO-8859-1"
+
+// converts a string with iconv; returns false on error
+static bool convert(iconv_t cd, const char* str, size_t len, std::string& out) {
+    out.resize(len * 4 + 4);
+    char* in = const_cast<char*>(str);
+    char* o = &out[0];
+    size_t o_left = out.size();
+    if (iconv(cd, &in, &len, &o, &o_left) == (size_t)-1)
+        return false;
+    iconv(cd, nullptr, nullptr, &o, &o_left);
+    out.resize(out.size() - o_left);
+    return true;
+}
+
+// converts each value with its own conversion descriptor, like QoreString::convertEncoding()
+struct per_value_handler {
+    size_t sum = 0;
+    std::string buf;
+
+    int element(const char* name, int depth) {
+        sum += strlen(name) + depth;
+        return 0;
+    }
+
+    bool skipSubtree() const {
+        return false;
+    }
+
+    int attribute(const char* name, const char* value, size_t len) {
+        sum += strlen(name);
+        return value_intern(value, len);
+    }
+
+    int endAttributes() {
+        ++sum;
+        return 0;
+    }
+
+    int text(const char* str, size_t len, int depth) {
+        return value_intern(str, len);
+    }
+
+    int cdata(const char* str, size_t len, int depth) {
+        return value_intern(str, len);
+    }
+
+    int comment(const char* str, size_t len, int depth) {
+        return 0;
+    }
+
+    int value_intern(const char* str, size_t len) {
+        iconv_t cd = iconv_open(BENCH_ENCODING, "UTF-8");
+        bool ok = convert(cd, str, len, buf);
+        iconv_close(cd);
+        if (!ok)
+            return -1;
+        sum += buf.size();
+        return 0;
+    }
+};
+
+// uses one conversion descriptor for the document and copies ASCII values, like QoreXmlDataBuilder
+struct shared_handler : public per_value_handler {
+    iconv_t cd;
+
+    shared_handler() : cd(iconv_open(BENCH_ENCODING, "UTF-8")) {
+    }
+
+    ~shared_handler() {
+        iconv_close(cd);
+    }
+
+    int attribute(const char* name, const char* value, size_t len) {
+        sum += strlen(name);
+        return value_intern(value, len);
+    }
+
+    int text(const char* str, size_t len, int depth) {
+        return value_intern(str, len);
+    }
+
+    int cdata(const char* str, size_t len, int depth) {
+        return value_intern(str, len);
+    }
+
+    int value_intern(const char* str, size_t len) {
+        bool ascii = true;
+        for (size_t i = 0; i < len; ++i) {
+            if (str[i] & 0x80) {
+                ascii = false;
+                break;
+            }
+        }
+        if (ascii) {
+            buf.assign(str, len);
+        } else if (!convert(cd, str, len, buf)) {
+            return -1;
+        }
+        sum += buf.size();
+        return 0;
+    }
+};
+
+// converts the document to UTF-8 before parsing it, as parse_xml() did
+static size_t parse_convert(const std::string& xml) {
+    std::string utf8;
+    iconv_t cd = iconv_open("UTF-8", BENCH_ENCODING);
+    bool ok = convert(cd, xml.data(), xml.size(), utf8);
+    iconv_close(cd);
+    if (!ok)
+        return 0;
+    per_value_handler h;
+    XmlSaxParser<per_value_handler> parser(h, false);
+    return parser.parse(utf8.data(), utf8.size(), BENCH_PARSER_OPTIONS) ? 0 : h.sum;
+}
+
+// libxml2 decodes the document directly
+static size_t parse_direct(const std::string& xml) {
+    shared_handler h;
+    XmlSaxParser<shared_handler> parser(h, false);
+    return parser.parse(xml.data(), xml.size(), BENCH_PARSER_OPTIONS, BENCH_ENCODING) ? 0 : h.sum;
+}
+
+template <typename F>
+static void run(const char* name, F f, const std::string& xml, int iters, size_t& sum) {
+    auto start = std::chrono::steady_clock::now();
+    sum = 0;
+    for (int i = 0; i < iters; ++i)
+        sum += f(xml);
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    double ms = d.count() * 1000 / iters;
+    printf("  %-8s %14.3f %14.1f\n", name, ms, xml.size() / (ms * 1000));
+}
+
+// a formatted ISO-8859-1 document with "count" records; every "accented"th field contains non-ASCII text
+static std::string make_records(int count, int fields, int accented) {
+    std::string rv = "<records>\n";
+    for (int c = 0; c < count; ++c) {
+        rv += "  <record id=\"" + std::to_string(c) + "\" city=\"M\xfcnchen\">\n";
+        for (int f = 0; f < fields; ++f) {
+            rv += "    <field" + std::to_string(f) + ">" + ((f % accented) ? "value " : "caf\xe9 cr\xe8me ")
+                + std::to_string(c * fields + f) + "</field" + std::to_string(f) + ">\n";
+        }
+        rv += "  </record>\n";
+    }
+    rv += "</records>\n";
+    return rv;
+}
+
+int main(int argc, char* argv[]) {
+    int iters = argc > 1 ? atoi(argv[1]) : 10;
+    xmlInitParser();
+
+    struct {
+        const char* name;
+        std::string xml;
+    } cases[2];
+    cases[0].name = "records: 20000 records x 10 fields, 1 in 10 non-ASCII";
+    cases[0].xml = make_records(20000, 10, 10);
+    cases[1].name = "records: 20000 records x 10 fields, all non-ASCII";
+    cases[1].xml = make_records(20000, 10, 1);
+
+    int rc = 0;
+    for (auto& c : cases) {
+        printf("%s (%.1f MB)\n", c.name, c.xml.size() / 1000000.0);
+        printf("  %-8s %14s %14s\n", "parser", "ms/parse", "MB/s");
+        size_t convert_sum, direct_sum;
+        run("convert", parse_convert, c.xml, iters, convert_sum);
+        run("direct", parse_direct, c.xml, iters, direct_sum);
+        if (!convert_sum || convert_sum != direct_sum) {
+            fprintf(stderr, "ERROR: checksum mismatch for case \"%s\"\n", c.name);
+            rc = 1;
+        }
+    }
+    xmlCleanupParser();
+    return rc;
+}